@@ -0,0 +1,96 @@
+#include <cstdint>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../lib/bloom_filter"
+
+namespace
+{
+    constexpr size_t const num_keys = 1 << 16;
+
+    std::vector<std::uint64_t> make_keys(std::uint64_t const seed)
+    {
+        std::mt19937_64 generator (seed);
+        std::vector<std::uint64_t> keys (num_keys);
+        for (auto& k : keys) k = generator();
+        return keys;
+    }
+
+    /**
+     * Probe keys, half of them members.
+     */
+    std::vector<std::uint64_t> make_probes(std::vector<std::uint64_t> const& members)
+    {
+        auto probes = make_keys(2);
+        for (size_t i = 0; i < probes.size(); i += 2) probes[i] = members[(i * 7919) % members.size()];
+        return probes;
+    }
+
+    /**
+     * Construct a filter of a number of bits, with 8 hash functions and
+     * backed by huge pages.
+     */
+    template<typename filter_t>
+    filter_t make_filter(size_t const num_bits)
+    {
+        if constexpr (std::is_constructible_v<filter_t, size_t, size_t, bool>)
+            return filter_t(num_bits, 8, true);
+        else
+            return filter_t(num_bits, true);
+    }
+
+    /**
+     * Probe a filter of state.range(0) bits, backed by huge pages, with one key
+     * at a time.
+     */
+    template<typename filter_t>
+    void BM_test(benchmark::State& state)
+    {
+        auto filter = make_filter<filter_t>(state.range(0));
+        auto const members = make_keys(1);
+        for (auto const& k : members) filter.add(k);
+        auto const probes = make_probes(members);
+
+        for (auto _ : state)
+        {
+            size_t hits = 0;
+            for (auto const& k : probes) hits += filter.test(k);
+            benchmark::DoNotOptimize(hits);
+        }
+        state.SetItemsProcessed(state.iterations() * probes.size());
+    }
+
+    /**
+     * Probe a filter of state.range(0) bits, backed by huge pages, with the
+     * batch interface.
+     */
+    template<typename filter_t>
+    void BM_test_batch(benchmark::State& state)
+    {
+        auto filter = make_filter<filter_t>(state.range(0));
+        auto const members = make_keys(1);
+        filter.add_batch(members.data(), members.size());
+        auto const probes = make_probes(members);
+        std::vector<std::uint64_t> results ((probes.size() + 63) / 64);
+
+        for (auto _ : state)
+        {
+            filter.test_batch(probes.data(), probes.size(), results.data());
+            benchmark::DoNotOptimize(results.data());
+        }
+        state.SetItemsProcessed(state.iterations() * probes.size());
+    }
+}
+
+// from L2-resident (32 KiB) to far beyond LLC (512 MiB)
+BENCHMARK_TEMPLATE(BM_test, dynamic_bloom_filter<std::uint64_t>)->Arg(1 << 18)->Arg(1l << 32);
+BENCHMARK_TEMPLATE(BM_test_batch, dynamic_bloom_filter<std::uint64_t>)->Arg(1 << 18)->Arg(1l << 32);
+BENCHMARK_TEMPLATE(BM_test, blocked_bloom_filter<std::uint64_t>)->Arg(1 << 18)->Arg(1l << 32);
+BENCHMARK_TEMPLATE(BM_test_batch, blocked_bloom_filter<std::uint64_t>)->Arg(1 << 18)->Arg(1l << 32);
+BENCHMARK_TEMPLATE(BM_test, simd_blocked_bloom_filter<std::uint64_t>)->Arg(1 << 18)->Arg(1l << 32);
+BENCHMARK_TEMPLATE(BM_test_batch, simd_blocked_bloom_filter<std::uint64_t>)->Arg(1 << 18)->Arg(1l << 32);
+
+BENCHMARK_MAIN();
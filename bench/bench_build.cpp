@@ -0,0 +1,120 @@
+#include <cstdint>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../lib/bloom_filter"
+
+namespace
+{
+    constexpr size_t const num_keys = 1 << 24;
+
+    template<typename K> std::vector<K> const& keys();
+
+    template<> std::vector<std::uint64_t> const& keys()
+    {
+        static auto const result = []
+        {
+            std::mt19937_64 generator (1);
+            std::vector<std::uint64_t> k (num_keys);
+            for (auto& v : k) v = generator();
+            return k;
+        }();
+        return result;
+    }
+
+    template<> std::vector<std::string> const& keys()
+    {
+        static auto const result = []
+        {
+            std::vector<std::string> k;
+            k.reserve(num_keys);
+            for (size_t i = 0; i < num_keys; ++i) k.push_back("https://example.com/item/" + std::to_string(i));
+            return k;
+        }();
+        return result;
+    }
+
+    /**
+     * Build a filter for 1% false positives over 2^24 keys with
+     * state.range(0) threads. The filter (20 MiB) is larger than most
+     * LLCs, so this measures hashing and cache misses alike.
+     */
+    template<typename K, typename hashing>
+    void BM_build(benchmark::State& state)
+    {
+        auto const& k = keys<K>();
+        auto const parameters = optimal_parameters(num_keys, 0.01);
+
+        for (auto _ : state)
+        {
+            dynamic_bloom_filter<K, hashing> filter (parameters);
+            filter.build(k.begin(), k.end(), state.range(0));
+            benchmark::DoNotOptimize(filter);
+        }
+        state.SetItemsProcessed(state.iterations() * num_keys);
+    }
+
+    /**
+     * Build a partitioned filter with one shard per thread over the same
+     * keys, with state.range(0) threads, each on the node of its shard.
+     */
+    template<typename K>
+    void BM_build_partitioned(benchmark::State& state)
+    {
+        auto const& k = keys<K>();
+        auto const parameters = optimal_parameters(num_keys, 0.01);
+
+        for (auto _ : state)
+        {
+            partitioned_bloom_filter<K> filter (parameters.num_bits, parameters.num_hash_functions,
+                    state.range(0) * detail::numa::nodes().size());
+            filter.build(k.begin(), k.end());
+            benchmark::DoNotOptimize(filter);
+        }
+        state.SetItemsProcessed(state.iterations() * num_keys);
+    }
+
+    /**
+     * Test all keys, half of them members, against a partitioned filter
+     * with state.range(0) threads.
+     */
+    void BM_test_batch_partitioned(benchmark::State& state)
+    {
+        auto const& k = keys<std::uint64_t>();
+        auto const parameters = optimal_parameters(num_keys / 2, 0.01);
+        partitioned_bloom_filter<std::uint64_t> filter (parameters.num_bits, parameters.num_hash_functions);
+        filter.build(k.begin(), k.begin() + num_keys / 2);
+        std::vector<std::uint64_t> results ((num_keys + 63) / 64);
+
+        for (auto _ : state)
+        {
+            filter.test_batch(k.data(), k.size(), results.data(), state.range(0));
+            benchmark::DoNotOptimize(results.data());
+        }
+        state.SetItemsProcessed(state.iterations() * num_keys);
+    }
+
+    /**
+     * Thread counts from 1 to twice the number of hardware threads.
+     */
+    void thread_counts(benchmark::internal::Benchmark* b)
+    {
+        size_t const max_threads = 2 * detail::default_num_threads();
+        for (size_t t = 1; t < max_threads; t *= 2) b->Arg(t);
+        b->Arg(max_threads);
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_build, std::uint64_t, independent_hashing)->Apply(thread_counts)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_build, std::string, independent_hashing)->Apply(thread_counts)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_build, std::string, double_hashing)->Apply(thread_counts)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_build_partitioned, std::uint64_t)->Apply(thread_counts)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_build_partitioned, std::string)->Apply(thread_counts)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_test_batch_partitioned)->Apply(thread_counts)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
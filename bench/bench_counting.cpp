@@ -0,0 +1,90 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../lib/bloom_filter"
+
+namespace
+{
+    constexpr size_t const num_keys = 1 << 16;
+    constexpr size_t const num_hash_functions = 7;
+
+    std::vector<std::uint64_t> make_keys(std::uint64_t const seed)
+    {
+        std::mt19937_64 generator (seed);
+        std::vector<std::uint64_t> keys (num_keys);
+        for (auto& k : keys) k = generator();
+        return keys;
+    }
+
+    /**
+     * Add keys to a filter of state.range(0) slots.
+     */
+    template<typename filter_t>
+    void BM_add(benchmark::State& state)
+    {
+        filter_t filter (state.range(0), num_hash_functions);
+        auto const keys = make_keys(1);
+
+        for (auto _ : state)
+        {
+            for (auto const& k : keys) filter.add(k);
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(state.iterations() * keys.size());
+    }
+
+    /**
+     * Test keys, half of them members, against a filter of state.range(0)
+     * slots.
+     */
+    template<typename filter_t>
+    void BM_test(benchmark::State& state)
+    {
+        filter_t filter (state.range(0), num_hash_functions);
+        auto const members = make_keys(1);
+        for (auto const& k : members) filter.add(k);
+        auto probes = make_keys(2);
+        for (size_t i = 0; i < probes.size(); i += 2) probes[i] = members[i];
+
+        for (auto _ : state)
+        {
+            size_t hits = 0;
+            for (auto const& k : probes) hits += filter.test(k);
+            benchmark::DoNotOptimize(hits);
+        }
+        state.SetItemsProcessed(state.iterations() * probes.size());
+    }
+
+    /**
+     * Remove all keys of a filter of state.range(0) slots. They are added
+     * back with the timer paused.
+     */
+    void BM_remove(benchmark::State& state)
+    {
+        counting_bloom_filter<std::uint64_t> filter (state.range(0), num_hash_functions);
+        auto const keys = make_keys(1);
+        for (auto const& k : keys) filter.add(k);
+
+        for (auto _ : state)
+        {
+            for (auto const& k : keys) filter.remove(k);
+            state.PauseTiming();
+            for (auto const& k : keys) filter.add(k);
+            state.ResumeTiming();
+        }
+        state.SetItemsProcessed(state.iterations() * keys.size());
+    }
+}
+
+// from 2^16 slots (32 KiB of counters, 8 KiB of bits) to 2^30 slots (512 MiB
+// of counters, 128 MiB of bits)
+BENCHMARK_TEMPLATE(BM_add, dynamic_bloom_filter<std::uint64_t>)->Arg(1 << 16)->Arg(1 << 22)->Arg(1l << 30);
+BENCHMARK_TEMPLATE(BM_add, counting_bloom_filter<std::uint64_t>)->Arg(1 << 16)->Arg(1 << 22)->Arg(1l << 30);
+BENCHMARK_TEMPLATE(BM_test, dynamic_bloom_filter<std::uint64_t>)->Arg(1 << 16)->Arg(1 << 22)->Arg(1l << 30);
+BENCHMARK_TEMPLATE(BM_test, counting_bloom_filter<std::uint64_t>)->Arg(1 << 16)->Arg(1 << 22)->Arg(1l << 30);
+BENCHMARK(BM_remove)->Arg(1 << 16)->Arg(1 << 22)->Arg(1l << 30);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,321 @@
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../lib/bloom_filter"
+
+/**
+ * Custom key type, hashed through its std::hash specialization.
+ */
+struct record
+{
+    std::string name;
+    int id;
+};
+
+namespace std
+{
+    template<>
+    struct hash<record>
+    {
+        size_t operator()(record const& r) const noexcept
+        {
+            return std::hash<std::string>{}(r.name) ^ (std::hash<int>{}(r.id) * 0x9e3779b97f4a7c15ull);
+        }
+    };
+}
+
+namespace
+{
+    /**
+     * Short strings fit the small string buffer, long ones do not.
+     */
+    struct short_string {};
+    struct long_string {};
+
+    constexpr size_t const num_probes = 1 << 16;
+
+    /**
+     * At most this many keys are added, so that filters far beyond the LLC
+     * can be built in reasonable time. Below that, filters are loaded with
+     * 10 bits per key, close to the optimum for 7 hash functions.
+     */
+    constexpr size_t const max_members = 1 << 22;
+
+    template<typename K> struct key_type { using type = K; };
+    template<> struct key_type<short_string> { using type = std::string; };
+    template<> struct key_type<long_string> { using type = std::string; };
+
+    template<typename K>
+    using key_t = typename key_type<K>::type;
+
+    /**
+     * The i-th key of a key family. Different seeds give disjoint keys.
+     */
+    template<typename K>
+    key_t<K> make_key(std::uint64_t const i, std::uint64_t const seed)
+    {
+        std::uint64_t const x = i * 2 + seed;
+        if constexpr (std::is_same_v<K, int>)
+            return static_cast<int>(x);
+        else if constexpr (std::is_same_v<K, short_string>)
+            return "k" + std::to_string(x);
+        else if constexpr (std::is_same_v<K, long_string>)
+            return std::string(80, '.') + std::to_string(x);
+        else
+            return record { "record " + std::to_string(x), static_cast<int>(x % 1000) };
+    }
+
+    template<typename K>
+    std::vector<key_t<K>> make_keys(size_t const count, std::uint64_t const seed)
+    {
+        std::vector<key_t<K>> keys;
+        keys.reserve(count);
+        for (size_t i = 0; i < count; ++i) keys.push_back(make_key<K>(i, seed));
+        return keys;
+    }
+
+    size_t num_members(size_t const num_bits)
+    {
+        return std::max<size_t>(1, std::min(num_bits / 10, max_members));
+    }
+
+    /**
+     * Report the time per key next to the throughput.
+     */
+    void report(benchmark::State& state, size_t const keys_per_iteration)
+    {
+        state.SetItemsProcessed(state.iterations() * keys_per_iteration);
+        state.counters["time_per_key"] = benchmark::Counter(
+                static_cast<double>(keys_per_iteration),
+                benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+    }
+
+    /**
+     * Add keys to a filter of state.range(0) bits with state.range(1) hash
+     * functions.
+     */
+    template<typename K>
+    void BM_add(benchmark::State& state)
+    {
+        dynamic_bloom_filter<key_t<K>> filter (state.range(0), state.range(1));
+        auto const keys = make_keys<K>(num_probes, 0);
+
+        for (auto _ : state)
+        {
+            for (auto const& k : keys) filter.add(k);
+            benchmark::ClobberMemory();
+        }
+        report(state, keys.size());
+    }
+
+    /**
+     * Test keys against a filter of state.range(0) bits with state.range(1)
+     * hash functions, of which state.range(2) percent are members.
+     */
+    template<typename K>
+    void BM_test(benchmark::State& state)
+    {
+        dynamic_bloom_filter<key_t<K>> filter (state.range(0), state.range(1));
+        size_t const n = num_members(state.range(0));
+        for (size_t i = 0; i < n; ++i) filter.add(make_key<K>(i, 0));
+
+        // members and non-members interleaved at random, so the branch
+        // predictor can not learn the outcome
+        std::mt19937_64 generator (1);
+        std::vector<key_t<K>> probes;
+        for (size_t i = 0; i < num_probes; ++i)
+        {
+            bool const hit = generator() % 100 < static_cast<std::uint64_t>(state.range(2));
+            probes.push_back(hit ? make_key<K>(generator() % n, 0) : make_key<K>(i, 1));
+        }
+
+        for (auto _ : state)
+        {
+            size_t hits = 0;
+            for (auto const& k : probes) hits += filter.test(k);
+            benchmark::DoNotOptimize(hits);
+        }
+        report(state, probes.size());
+    }
+
+    /**
+     * Test long string tokens that are parsed out of one buffer, as from a
+     * network packet, against an LLC-resident filter of 2 MiB. With
+     * <code>convert</code> every token is first copied into a
+     * <code>std::string</code>, as before filters took string views.
+     */
+    template<bool convert>
+    void BM_test_tokens(benchmark::State& state)
+    {
+        dynamic_bloom_filter<std::string> filter (1 << 24, 7);
+        std::string buffer;
+        std::vector<std::pair<size_t, size_t>> tokens;
+        for (size_t i = 0; i < num_probes; ++i)
+        {
+            auto const key = make_key<long_string>(i, i % 2);
+            if (i % 2 == 0) filter.add(key);
+            tokens.emplace_back(buffer.size(), key.size());
+            buffer += key;
+        }
+
+        for (auto _ : state)
+        {
+            size_t hits = 0;
+            for (auto const& [offset, size] : tokens)
+            {
+                std::string_view const token (buffer.data() + offset, size);
+                if constexpr (convert) hits += filter.test(std::string(token));
+                else hits += filter.test(token);
+            }
+            benchmark::DoNotOptimize(hits);
+        }
+        report(state, tokens.size());
+    }
+
+    /**
+     * Test int keys, half of them members, against an LLC-resident filter
+     * of 2 MiB with 7 hash functions and the given instrumentation policy,
+     * to show what counting costs.
+     */
+    template<typename instrumentation>
+    void BM_test_instrumented(benchmark::State& state)
+    {
+        dynamic_bloom_filter<int, independent_hashing, wyhash_hasher, instrumentation> filter (1 << 24, 7);
+        for (int i = 0; i < static_cast<int>(num_members(1 << 24)); i += 2) filter.add(i);
+        auto const probes = make_keys<int>(num_probes, 0);
+
+        for (auto _ : state)
+        {
+            size_t hits = 0;
+            for (auto const k : probes) hits += filter.test(k);
+            benchmark::DoNotOptimize(hits);
+        }
+        report(state, probes.size());
+    }
+
+    /**
+     * Test int keys against one of 4096 per-row filters of 512 bits with 4
+     * hash functions, 40 values each, picking the row at random per probe.
+     */
+    template<typename filter_t>
+    void BM_test_rows(benchmark::State& state)
+    {
+        constexpr size_t const num_rows = 4096;
+        std::vector<filter_t> rows (num_rows);
+        for (size_t r = 0; r < num_rows; ++r)
+        {
+            for (int i = 0; i < 40; ++i) rows[r].add(static_cast<int>(r * 40) + i);
+        }
+
+        std::mt19937_64 generator (1);
+        std::vector<std::pair<size_t, int>> probes;
+        for (size_t i = 0; i < num_probes; ++i)
+        {
+            size_t const r = generator() % num_rows;
+            probes.emplace_back(r, static_cast<int>(r * 40 + generator() % 80));
+        }
+
+        for (auto _ : state)
+        {
+            size_t hits = 0;
+            for (auto const& [r, k] : probes) hits += rows[r].test(k);
+            benchmark::DoNotOptimize(hits);
+        }
+        report(state, probes.size());
+    }
+
+    /**
+     * Estimate the number of values in a filter of state.range(0) bits,
+     * which scans all of its bits. The time does not depend on how full the
+     * filter is.
+     */
+    void BM_estimated_size(benchmark::State& state)
+    {
+        dynamic_bloom_filter<std::uint64_t> filter (state.range(0), 7);
+        size_t const n = num_members(state.range(0));
+        for (std::uint64_t i = 0; i < n; ++i) filter.add(i);
+
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(filter.estimated_size());
+        }
+        state.SetBytesProcessed(state.iterations() * state.range(0) / 8);
+    }
+
+    /**
+     * Filter sizes from L1-resident (4 KiB) to far beyond the LLC (1 GiB),
+     * with 7 hash functions and half of the probes members.
+     */
+    void sizes(benchmark::internal::Benchmark* b, bool const with_hit_ratio)
+    {
+        b->ArgNames(with_hit_ratio ? std::vector<std::string>{ "bits", "k", "hits" }
+                : std::vector<std::string>{ "bits", "k" });
+        for (std::int64_t bits = 1 << 15; bits <= (1l << 33); bits *= 8)
+        {
+            if (with_hit_ratio) b->Args({ bits, 7, 50 });
+            else b->Args({ bits, 7 });
+        }
+    }
+
+    /**
+     * Hash counts, and for tests hit ratios, on an LLC-resident filter of
+     * 2 MiB.
+     */
+    void parameters(benchmark::internal::Benchmark* b, bool const with_hit_ratio)
+    {
+        constexpr std::int64_t const bits = 1 << 24;
+        for (std::int64_t k : { 1, 2, 4, 8, 16 })
+        {
+            if (with_hit_ratio) b->Args({ bits, k, 50 });
+            else b->Args({ bits, k });
+        }
+        if (with_hit_ratio)
+        {
+            b->Args({ bits, 7, 0 });
+            b->Args({ bits, 7, 100 });
+        }
+    }
+
+    void add_args(benchmark::internal::Benchmark* b)
+    {
+        sizes(b, false);
+        parameters(b, false);
+    }
+
+    void test_args(benchmark::internal::Benchmark* b)
+    {
+        sizes(b, true);
+        parameters(b, true);
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_add, int)->Apply(add_args);
+BENCHMARK_TEMPLATE(BM_add, short_string)->Apply(add_args);
+BENCHMARK_TEMPLATE(BM_add, long_string)->Apply(add_args);
+BENCHMARK_TEMPLATE(BM_add, record)->Apply(add_args);
+
+BENCHMARK_TEMPLATE(BM_test, int)->Apply(test_args);
+BENCHMARK_TEMPLATE(BM_test, short_string)->Apply(test_args);
+BENCHMARK_TEMPLATE(BM_test, long_string)->Apply(test_args);
+BENCHMARK_TEMPLATE(BM_test, record)->Apply(test_args);
+
+BENCHMARK_TEMPLATE(BM_test_instrumented, no_instrumentation);
+BENCHMARK_TEMPLATE(BM_test_instrumented, counting_instrumentation);
+
+BENCHMARK_TEMPLATE(BM_test_rows, bloom_filter<int, 4, 9>);
+BENCHMARK_TEMPLATE(BM_test_rows, small_bloom_filter<int, 512, 4>);
+
+BENCHMARK(BM_estimated_size)->RangeMultiplier(8)->Range(1 << 15, 1l << 33)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_TEMPLATE(BM_test_tokens, true);
+BENCHMARK_TEMPLATE(BM_test_tokens, false);
+
+BENCHMARK_MAIN();
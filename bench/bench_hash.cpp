@@ -0,0 +1,109 @@
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../lib/bloom_filter"
+
+namespace
+{
+    constexpr size_t const precision = 20;
+    constexpr size_t const num_keys  = 1024;
+
+    /**
+     * The index computation hash_fn used before the word-level reduction: the
+     * 64 bits of the salted hash are XOR-folded into a bitset one at a time.
+     */
+    template<size_t hash_precision, typename data_t>
+    size_t legacy_fold(data_t const& data, size_t const salt)
+    {
+        salted_type<data_t> s {data, salt};
+        auto hash = std::hash<salted_type<data_t>>{}(s);
+
+        std::bitset<hash_precision> result;
+        std::bitset<8*sizeof(hash)> intermediate (hash);
+        for (size_t i = 0; i < intermediate.size(); ++i)
+        {
+            size_t const idx = i % result.size();
+            if (intermediate.test(i)) result.flip(idx);
+        }
+        return result.to_ulong();
+    }
+
+    template<typename T> std::vector<T> make_keys();
+
+    template<> std::vector<int> make_keys<int>()
+    {
+        std::vector<int> keys;
+        for (size_t i = 0; i < num_keys; ++i) keys.push_back(static_cast<int>(i));
+        return keys;
+    }
+
+    template<> std::vector<std::string> make_keys<std::string>()
+    {
+        std::vector<std::string> keys;
+        for (size_t i = 0; i < num_keys; ++i) keys.push_back("key-" + std::to_string(i));
+        return keys;
+    }
+
+    template<typename T>
+    void BM_legacy_fold(benchmark::State& state)
+    {
+        auto const keys = make_keys<T>();
+        for (auto _ : state)
+        {
+            for (auto const& k : keys)
+                benchmark::DoNotOptimize(legacy_fold<precision>(k, 0x1234567));
+        }
+        state.SetItemsProcessed(state.iterations() * keys.size());
+    }
+
+    template<typename T, typename hasher>
+    void BM_hash_fn(benchmark::State& state)
+    {
+        auto const keys = make_keys<T>();
+        size_t const range = state.range(0);
+        detail::hash_fn<T, hasher> const fn (0x1234567);
+        for (auto _ : state)
+        {
+            for (auto const& k : keys)
+                benchmark::DoNotOptimize(fn(k, range));
+        }
+        state.SetItemsProcessed(state.iterations() * keys.size());
+    }
+
+    template<typename T, typename hashing>
+    void BM_all_indices(benchmark::State& state)
+    {
+        auto const keys = make_keys<T>();
+        size_t const num_indices = state.range(0);
+        detail::index_generator<T, hashing> const generator (num_indices);
+        for (auto _ : state)
+        {
+            for (auto const& k : keys)
+            {
+                auto const hashed = generator.hash(k);
+                for (size_t i = 0; i < num_indices; ++i)
+                    benchmark::DoNotOptimize(hashed.index(i, 1 << precision));
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * keys.size());
+    }
+}
+
+BENCHMARK_TEMPLATE(BM_legacy_fold, int);
+BENCHMARK_TEMPLATE(BM_legacy_fold, std::string);
+// power of two and non-power of two ranges cost the same
+BENCHMARK_TEMPLATE(BM_hash_fn, int, std_hasher)->Arg(1 << precision)->Arg(1000003);
+BENCHMARK_TEMPLATE(BM_hash_fn, std::string, std_hasher)->Arg(1 << precision)->Arg(1000003);
+BENCHMARK_TEMPLATE(BM_hash_fn, int, wyhash_hasher)->Arg(1 << precision);
+BENCHMARK_TEMPLATE(BM_hash_fn, std::string, wyhash_hasher)->Arg(1 << precision);
+// all indices of a key, hashing once per index or once per key
+BENCHMARK_TEMPLATE(BM_all_indices, int, independent_hashing)->Arg(12);
+BENCHMARK_TEMPLATE(BM_all_indices, int, double_hashing)->Arg(12);
+BENCHMARK_TEMPLATE(BM_all_indices, std::string, independent_hashing)->Arg(12);
+BENCHMARK_TEMPLATE(BM_all_indices, std::string, double_hashing)->Arg(12);
+
+BENCHMARK_MAIN();
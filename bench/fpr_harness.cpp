@@ -0,0 +1,264 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../lib/bloom_filter"
+
+/**
+ * Measures the false positive rate of every filter variant and hash choice
+ * and compares it with theory. Each filter is built over n distinct keys and
+ * probed with n keys disjoint from them, so every positive is a false one.
+ * Writes one CSV line per configuration to stdout.
+ *
+ * Usage: fpr_harness [num_keys]
+ */
+namespace
+{
+    /**
+     * False positive rate of a standard bloom filter.
+     *
+     * \param bits_per_key  Bits per key
+     * \param k             Number of hash functions
+     * \return              False positive rate
+     */
+    double standard_fpr(double const bits_per_key, size_t const k)
+    {
+        return std::pow(1 - std::exp(-static_cast<double>(k) / bits_per_key), k);
+    }
+
+    /**
+     * False positive rate of a filter whose keys are spread over blocks of
+     * <code>words_per_block</code> sections of <code>section_bits</code> bits
+     * each. Every key sets <code>bits_per_section</code> bits in each
+     * section of one block. The number of keys per block is Poisson
+     * distributed, which is what makes blocked filters worse than standard
+     * ones.
+     *
+     * \param bits_per_key      Bits per key
+     * \param block_bits        Bits per block
+     * \param section_bits      Bits per section, <code>block_bits</code> if
+     *                          the block is not split
+     * \param bits_per_section  Bits set per key in each section
+     * \return                  False positive rate
+     */
+    double blocked_fpr(double const bits_per_key, size_t const block_bits,
+            size_t const section_bits, size_t const bits_per_section)
+    {
+        double const keys_per_block = block_bits / bits_per_key;
+        size_t const sections = block_bits / section_bits;
+        double const bits_per_key_in_block = static_cast<double>(sections * bits_per_section);
+
+        double fpr = 0;
+        double poisson = std::exp(-keys_per_block);
+        for (size_t i = 0; i < 10 * block_bits; ++i)
+        {
+            double const unset = std::pow(1 - 1.0 / section_bits, bits_per_section * i);
+            fpr += poisson * std::pow(1 - unset, bits_per_key_in_block);
+            poisson *= keys_per_block / (i + 1);
+        }
+        return fpr;
+    }
+
+    double seconds_since(std::chrono::steady_clock::time_point const start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    template<typename K> std::vector<K> make_keys(size_t count, size_t first);
+
+    template<> std::vector<std::uint64_t> make_keys(size_t const count, size_t const first)
+    {
+        // sequential keys are the hardest case for weak hash functions
+        std::vector<std::uint64_t> keys;
+        for (size_t i = first; i < first + count; ++i) keys.push_back(i);
+        return keys;
+    }
+
+    template<> std::vector<std::string> make_keys(size_t const count, size_t const first)
+    {
+        std::vector<std::string> keys;
+        for (size_t i = first; i < first + count; ++i) keys.push_back("key-" + std::to_string(i));
+        return keys;
+    }
+
+    template<typename T> char const* name();
+    template<> char const* name<std::uint64_t>() { return "u64"; }
+    template<> char const* name<std::string>() { return "string"; }
+    template<> char const* name<independent_hashing>() { return "independent"; }
+    template<> char const* name<double_hashing>() { return "double"; }
+    template<> char const* name<wyhash_hasher>() { return "wyhash"; }
+    template<> char const* name<std_hasher>() { return "std"; }
+
+    /**
+     * Number of memory locations a test looks at: the hash functions of a
+     * bloom filter, or the two buckets of a cuckoo filter.
+     */
+    template<typename filter_t>
+    size_t probes_per_test(filter_t const& filter)
+    {
+        return filter.num_hash_functions();
+    }
+
+    template<typename K, size_t fingerprint_bits, typename hasher>
+    size_t probes_per_test(cuckoo_filter<K, fingerprint_bits, hasher> const&)
+    {
+        return 2;
+    }
+
+    /**
+     * False positive rate of a cuckoo filter: a test compares the
+     * fingerprint with the occupied slots of two buckets.
+     *
+     * \param load              Fraction of occupied slots
+     * \param fingerprint_bits  Bits per fingerprint
+     * \return                  False positive rate
+     */
+    double cuckoo_fpr(double const load, size_t const fingerprint_bits)
+    {
+        double const fingerprints = static_cast<double>((size_t{1} << fingerprint_bits) - 1);
+        return 1 - std::pow(1 - 1 / fingerprints, 8 * load);
+    }
+
+    /**
+     * Build a filter over the members, probe it with the non-members and
+     * print the results as a CSV line.
+     */
+    template<typename filter_t, typename K>
+    void measure(filter_t filter, std::string const& variant, std::string const& hashing,
+            std::string const& hasher, std::vector<K> const& members,
+            std::vector<K> const& non_members, double const theory)
+    {
+        auto const build_start = std::chrono::steady_clock::now();
+        for (auto const& k : members) filter.add(k);
+        double const build_seconds = seconds_since(build_start);
+
+        auto const probe_start = std::chrono::steady_clock::now();
+        size_t false_positives = 0;
+        for (auto const& k : non_members) false_positives += filter.test(k);
+        double const probe_seconds = seconds_since(probe_start);
+
+        double const fpr = static_cast<double>(false_positives) / non_members.size();
+        std::cout << variant << ',' << name<K>() << ',' << hashing << ',' << hasher << ','
+            << members.size() << ',' << filter.num_bits() << ','
+            << static_cast<double>(filter.num_bits()) / members.size() << ','
+            << probes_per_test(filter) << ','
+            << fpr << ',' << theory << ',' << fpr / theory << ','
+            << members.size() / build_seconds / 1e6 << ','
+            << non_members.size() / probe_seconds / 1e6 << std::endl;
+    }
+
+    /**
+     * Measure the filters that support a choice of key type, hashing scheme
+     * and hasher.
+     */
+    template<typename K, typename hashing, typename hasher>
+    void measure_hashed(std::vector<K> const& members, std::vector<K> const& non_members,
+            size_t const bits_per_key)
+    {
+        size_t const num_bits = bits_per_key * members.size();
+        size_t const k = static_cast<size_t>(std::lround(bits_per_key * std::log(2.0)));
+
+        measure(dynamic_bloom_filter<K, hashing, hasher>(num_bits, k),
+                "dynamic", name<hashing>(), name<hasher>(), members, non_members,
+                standard_fpr(bits_per_key, k));
+        measure(concurrent_bloom_filter<K, hashing, hasher>(num_bits, k),
+                "concurrent", name<hashing>(), name<hasher>(), members, non_members,
+                standard_fpr(bits_per_key, k));
+
+        using blocked_t = blocked_bloom_filter<K, hashing, hasher>;
+        measure(blocked_t(num_bits, k),
+                "blocked", name<hashing>(), name<hasher>(), members, non_members,
+                blocked_fpr(bits_per_key, blocked_t::block_bits, blocked_t::block_bits, k));
+    }
+
+    template<typename K>
+    void measure_all(size_t const num_keys, size_t const bits_per_key)
+    {
+        auto const members = make_keys<K>(num_keys, 0);
+        auto const non_members = make_keys<K>(num_keys, num_keys);
+
+        measure_hashed<K, independent_hashing, wyhash_hasher>(members, non_members, bits_per_key);
+        measure_hashed<K, independent_hashing, std_hasher>(members, non_members, bits_per_key);
+        measure_hashed<K, double_hashing, wyhash_hasher>(members, non_members, bits_per_key);
+        measure_hashed<K, double_hashing, std_hasher>(members, non_members, bits_per_key);
+
+        if constexpr (std::is_integral_v<K>)
+        {
+            using simd_t = simd_blocked_bloom_filter<K>;
+            measure(simd_t(bits_per_key * num_keys),
+                    "simd_blocked", "split_block", "multiply", members, non_members,
+                    blocked_fpr(bits_per_key, simd_t::block_bits, 32, 1));
+        }
+    }
+
+    /**
+     * Measure cuckoo filters, which are sized by their capacity instead of
+     * bits per key.
+     */
+    template<typename K, size_t fingerprint_bits>
+    void measure_cuckoo(size_t const num_keys)
+    {
+        auto const members = make_keys<K>(num_keys, 0);
+        auto const non_members = make_keys<K>(num_keys, num_keys);
+
+        cuckoo_filter<K, fingerprint_bits> filter (num_keys);
+        double const load = static_cast<double>(num_keys) / (filter.num_buckets() * filter.bucket_slots);
+        measure(std::move(filter), "cuckoo_" + std::to_string(fingerprint_bits), "fingerprint",
+                "wyhash", members, non_members, cuckoo_fpr(load, fingerprint_bits));
+    }
+
+    /**
+     * Measure binary fuse filters, which are built from the whole key set
+     * at once. The build rate includes hashing the keys.
+     */
+    template<typename K, size_t fingerprint_bits>
+    void measure_fuse(size_t const num_keys)
+    {
+        auto const members = make_keys<K>(num_keys, 0);
+        auto const non_members = make_keys<K>(num_keys, num_keys);
+
+        auto const build_start = std::chrono::steady_clock::now();
+        binary_fuse_filter<K, fingerprint_bits> filter (members.begin(), members.end());
+        double const build_seconds = seconds_since(build_start);
+
+        auto const probe_start = std::chrono::steady_clock::now();
+        size_t false_positives = 0;
+        for (auto const& k : non_members) false_positives += filter.test(k);
+        double const probe_seconds = seconds_since(probe_start);
+
+        double const fpr = static_cast<double>(false_positives) / non_members.size();
+        double const theory = std::ldexp(1.0, -static_cast<int>(fingerprint_bits));
+        std::cout << "binary_fuse_" << fingerprint_bits << ',' << name<K>() << ",fingerprint,wyhash,"
+            << members.size() << ',' << filter.num_bits() << ','
+            << static_cast<double>(filter.num_bits()) / members.size() << ','
+            << filter.num_hash_functions() << ','
+            << fpr << ',' << theory << ',' << fpr / theory << ','
+            << members.size() / build_seconds / 1e6 << ','
+            << non_members.size() / probe_seconds / 1e6 << std::endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t const num_keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 21;
+
+    std::cout << "variant,key,hashing,hasher,keys,bits,bits_per_key,hash_functions,"
+        "measured_fpr,theoretical_fpr,fpr_ratio,build_mkeys_per_s,probe_mkeys_per_s" << std::endl;
+    for (size_t const bits_per_key : { 8, 10, 16 })
+    {
+        measure_all<std::uint64_t>(num_keys, bits_per_key);
+        measure_all<std::string>(num_keys, bits_per_key);
+    }
+    measure_cuckoo<std::uint64_t, 8>(num_keys);
+    measure_cuckoo<std::uint64_t, 12>(num_keys);
+    measure_cuckoo<std::uint64_t, 16>(num_keys);
+    measure_cuckoo<std::string, 16>(num_keys);
+    measure_fuse<std::uint64_t, 8>(num_keys);
+    measure_fuse<std::uint64_t, 16>(num_keys);
+    measure_fuse<std::string, 8>(num_keys);
+}
@@ -0,0 +1,172 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+#include "bit_array.hpp"
+
+#pragma once
+
+namespace detail
+{
+    /**
+     * Heap-allocated, runtime-sized array of bits that can be set and tested
+     * concurrently from any number of threads without locks. The bits are
+     * stored in <code>std::atomic</code> 64-bit words, laid out like the
+     * words of a <code>bit_array</code>.
+     *
+     * All operations use relaxed memory ordering: a bit set by one thread is
+     * eventually visible to all others, but setting a bit does not order any
+     * other memory accesses. Synchronize through other means (e.g. joining
+     * the writer threads) if readers must see a complete set of inserts.
+     */
+    class atomic_bit_array
+    {
+        public:
+            using word_t = std::uint64_t;
+
+            /**
+             * Number of bits in one storage word.
+             */
+            static constexpr size_t const word_bits = 8 * sizeof(word_t);
+
+            static_assert(std::atomic<word_t>::is_always_lock_free,
+                    "Atomic words must be lock free.");
+
+            /**
+             * Constructor. All bits are initially unset.
+             *
+             * \param num_bits      Number of bits to store
+             * \param huge_pages    Whether to try to back the storage with
+             *                      huge pages
+             */
+            explicit atomic_bit_array(size_t const num_bits, bool const huge_pages = false)
+            :   m_words(nullptr),
+                m_num_bits(num_bits),
+                m_num_words((num_bits + word_bits - 1) / word_bits),
+                m_huge_pages(huge_pages)
+            {
+                void* p = allocate_storage(allocation_size(), m_huge_pages);
+                m_words = static_cast<std::atomic<word_t>*>(p);
+                for (size_t i = 0; i < m_num_words; ++i)
+                {
+                    new (m_words + i) std::atomic<word_t>(0);
+                }
+            }
+
+            atomic_bit_array(atomic_bit_array const&) = delete;
+            atomic_bit_array& operator= (atomic_bit_array const&) = delete;
+
+            /**
+             * Move constructor.
+             *
+             * \param other     Other atomic_bit_array object (moved from)
+             */
+            atomic_bit_array(atomic_bit_array&& other) noexcept
+            :   m_words(std::exchange(other.m_words, nullptr)),
+                m_num_bits(std::exchange(other.m_num_bits, 0)),
+                m_num_words(std::exchange(other.m_num_words, 0)),
+                m_huge_pages(other.m_huge_pages)
+            {
+                // ctor
+            }
+
+            /**
+             * Destructor.
+             */
+            ~atomic_bit_array()
+            {
+                if (m_words == nullptr) return;
+                // std::atomic of an integer is trivially destructible
+                deallocate_storage(m_words, allocation_size(), m_huge_pages);
+            }
+
+            /**
+             * Set a bit. The word is only written if the bit is not set yet,
+             * so setting bits that are already set does not take the cache
+             * line away from other cores.
+             *
+             * \param idx   Index of the bit
+             */
+            void set(size_t const idx)
+            {
+                auto& word = m_words[idx / word_bits];
+                word_t const mask = word_t{1} << (idx % word_bits);
+                if ((word.load(std::memory_order_relaxed) & mask) == 0)
+                {
+                    word.fetch_or(mask, std::memory_order_relaxed);
+                }
+            }
+
+            /**
+             * Test a bit.
+             *
+             * \param idx   Index of the bit
+             * \return      Whether the bit is set
+             */
+            bool test(size_t const idx) const
+            {
+                return (m_words[idx / word_bits].load(std::memory_order_relaxed)
+                        >> (idx % word_bits)) & 1u;
+            }
+
+            /**
+             * Prefetch the word holding a bit, to be read.
+             *
+             * \param idx   Index of the bit
+             */
+            void prefetch_read(size_t const idx) const
+            {
+                detail::prefetch_read(m_words + idx / word_bits);
+            }
+
+            /**
+             * \return      Number of bits stored
+             */
+            size_t size() const { return m_num_bits; }
+
+            /**
+             * \return      Number of storage words
+             */
+            size_t num_words() const { return m_num_words; }
+
+            /**
+             * \param i     Index of the word
+             * \return      Current value of the word
+             */
+            word_t load(size_t const i) const
+            {
+                return m_words[i].load(std::memory_order_relaxed);
+            }
+
+        private:
+            /**
+             * \return      Number of bytes allocated for the storage words
+             */
+            size_t allocation_size() const
+            {
+                return storage_size(m_num_words * sizeof(word_t), m_huge_pages);
+            }
+
+            /**
+             * Pointer to the storage words.
+             */
+            std::atomic<word_t>* m_words;
+
+            /**
+             * Number of bits stored.
+             */
+            size_t m_num_bits;
+
+            /**
+             * Number of storage words.
+             */
+            size_t m_num_words;
+
+            /**
+             * Whether the storage is on the huge page path.
+             */
+            bool m_huge_pages;
+    }; // class atomic_bit_array
+} // namespace detail
@@ -0,0 +1,551 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "bit_array.hpp"
+#include "hash_fn.hpp"
+#include "hashers.hpp"
+#include "serialization.hpp"
+
+#pragma once
+
+/**
+ * Binary fuse filter (Graf and Lemire, "Binary Fuse Filters: Fast and
+ * Smaller Than Xor Filters"). A static filter built once from a known set of
+ * keys. Every key maps to three fingerprint slots in consecutive segments of
+ * the array, and construction chooses the slot contents so that the three
+ * fingerprints of every key xor to the key's own fingerprint. A test reads
+ * three slots, regardless of the false positive rate.
+ *
+ * The false positive rate is <code>1 / 2^fingerprint_bits</code>:
+ *  - 8 bit fingerprints: 0.39% at about 9 bits per key
+ *  - 16 bit fingerprints: 0.0015% at about 18 bits per key
+ * for large key sets, where a bloom filter needs about 11.5 and 23.9 bits per
+ * key for the same rates. Small sets need somewhat more space per key.
+ *
+ * Keys can not be added after construction. The hashes of the keys are
+ * computed in parallel; placing them (the "peeling") is sequential. A key
+ * set that contains duplicates is fine: the first attempt fails and the
+ * duplicates are removed before the next one.
+ *
+ * The filter can be written to a stream with <code>save</code> and read back
+ * with <code>load</code>. It offers <code>test</code> and
+ * <code>test_batch</code> like the bloom filters, so it can replace one at
+ * query sites whose key set does not change.
+ *
+ * \param T                 Template parameter for the type to build the
+ *                          filter for. As for <code>bloom_filter</code>, user
+ *                          types need a <code>std::hash</code>
+ *                          specialization.
+ * \param fingerprint_bits  Bits per fingerprint, 8 or 16.
+ * \param hasher            Hasher, e.g. <code>wyhash_hasher</code> or
+ *                          <code>std_hasher</code>.
+ */
+template<typename T, size_t fingerprint_bits = 8, typename hasher = wyhash_hasher>
+class binary_fuse_filter
+{
+    public:
+        static_assert(fingerprint_bits == 8 or fingerprint_bits == 16,
+                "Fingerprints must have 8 or 16 bits.");
+
+        using fingerprint_t = std::conditional_t<fingerprint_bits == 8, std::uint8_t, std::uint16_t>;
+
+        /**
+         * Number of slots a key maps to.
+         */
+        static constexpr size_t const arity = 3;
+
+        /**
+         * Number of seeds tried before construction gives up. A single
+         * attempt succeeds with high probability, so running out means the
+         * hasher does not spread the keys.
+         */
+        static constexpr size_t const max_attempts = 100;
+
+        /**
+         * Number of keys a construction thread hashes at least. Smaller key
+         * sets are hashed by fewer threads.
+         */
+        static constexpr size_t const min_keys_per_thread = 1 << 16;
+
+        /**
+         * Number of values hashed ahead in <code>test_batch</code>. The
+         * memory accesses of all their slots are in flight at the same time.
+         */
+        static constexpr size_t const batch_window = 8;
+
+        /**
+         * Constructor. Builds the filter from a range of keys. Derives the
+         * salt value of the hash function and the seeds to try from the
+         * default seed.
+         *
+         * \param first         Iterator to the first key
+         * \param last          Iterator past the last key
+         * \param num_threads   Number of threads hashing the keys
+         * \throw std::runtime_error if no seed places all keys
+         */
+        template<typename iterator_t>
+        binary_fuse_filter(iterator_t first, iterator_t const last, size_t const num_threads = 1)
+        :   m_hash_function(),
+            m_seed(0),
+            m_segment_length(0),
+            m_segment_count_length(0),
+            m_size(0),
+            m_fingerprints()
+        {
+            if (num_threads == 0)
+                throw std::invalid_argument("binary fuse filter needs at least one thread");
+
+            std::uint64_t seed = detail::default_seed;
+            m_hash_function = detail::hash_fn<T, hasher>(detail::splitmix64(seed));
+
+            std::vector<std::uint64_t> hashes (static_cast<size_t>(std::distance(first, last)));
+            hash_keys(first, hashes, num_threads);
+
+            size_t const array_length = layout(hashes.size());
+            m_fingerprints.assign(array_length, 0);
+            if (hashes.empty()) return;
+
+            for (size_t attempt = 0; not populate(hashes, detail::splitmix64(seed)); ++attempt)
+            {
+                if (attempt + 1 == max_attempts)
+                    throw std::runtime_error("could not build binary fuse filter");
+
+                // a key that occurs twice can never be peeled, so drop
+                // duplicates before retrying; sorting is only worth it then
+                if (attempt == 0)
+                {
+                    std::sort(hashes.begin(), hashes.end());
+                    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+                    m_fingerprints.assign(layout(hashes.size()), 0);
+                }
+            }
+        };
+
+        /**
+         * Destructor.
+         */
+        ~binary_fuse_filter() = default;
+
+        /**
+         * Test whether a value is in the filter. The return value
+         * <code>false</code> means that the value is <i>guaranteed</i> not to
+         * be in the filter. The return value <code>true</code> means that the
+         * value <i>maybe</i> is in the set.
+         *
+         * \param t     Data item to check for
+         * \return      Boolean value indicating membership
+         */
+        bool test(T const& t) const
+        {
+            if (m_fingerprints.empty()) return false;
+
+            return contains(mix(m_hash_function.hash(t)));
+        };
+
+        /**
+         * Test a batch of values. The slots of <code>batch_window</code>
+         * values are prefetched before any of them is read, which hides the
+         * memory latency of large filters.
+         *
+         * \param values    Values to check for
+         * \param count     Number of values
+         * \param results   Output, bitmap of <code>(count + 63) / 64</code>
+         *                  words; bit <code>i</code> is set if
+         *                  <code>values[i]</code> maybe is in the set
+         */
+        void test_batch(T const* values, size_t const count, std::uint64_t* results) const
+        {
+            std::fill(results, results + (count + 63) / 64, 0);
+            if (m_fingerprints.empty()) return;
+
+            std::array<std::uint64_t, batch_window> hashes;
+            for (size_t first = 0; first < count; first += batch_window)
+            {
+                size_t const n = std::min(batch_window, count - first);
+                for (size_t v = 0; v < n; ++v)
+                {
+                    hashes[v] = mix(m_hash_function.hash(values[first + v]));
+                    for (size_t const idx : positions(hashes[v]))
+                    {
+                        detail::prefetch_read(m_fingerprints.data() + idx);
+                    }
+                }
+                for (size_t v = 0; v < n; ++v)
+                {
+                    size_t const pos = first + v;
+                    results[pos / 64] |= std::uint64_t{contains(hashes[v])} << (pos % 64);
+                }
+            }
+        };
+
+        /**
+         * \return      Number of distinct keys in the filter
+         */
+        size_t size() const { return m_size; }
+
+        /**
+         * \return      Number of bits in the filter
+         */
+        size_t num_bits() const { return m_fingerprints.size() * fingerprint_bits; }
+
+        /**
+         * \return      Number of slots read per test
+         */
+        size_t num_hash_functions() const { return arity; }
+
+        /**
+         * Write the filter to a stream, in the format described by
+         * <code>detail::file_header</code>. Open file streams in binary
+         * mode.
+         *
+         * \param out   Stream to write to
+         * \throw std::runtime_error if writing fails
+         */
+        void save(std::ostream& out) const
+        {
+            std::vector<size_t> const parameters {
+                m_hash_function.salt(), m_seed, m_segment_length, m_segment_count_length, m_size
+            };
+            auto const header = make_header(num_bits(), parameters.size());
+            detail::write_filter(out, header, parameters, m_fingerprints.data());
+        };
+
+        /**
+         * Read a filter written by <code>save</code> from a stream. The
+         * filter must have been saved with the same fingerprint size and
+         * hasher.
+         *
+         * \param in    Stream to read from
+         * \return      The filter
+         * \throw std::runtime_error if the stream does not hold a matching
+         *              filter
+         */
+        static binary_fuse_filter load(std::istream& in)
+        {
+            auto const header = detail::read_header(in);
+            detail::check_header(header, make_header(header.num_bits, header.num_salts));
+            if (header.num_salts != num_parameters or header.num_hash_functions != arity
+                    or header.num_bits % fingerprint_bits != 0)
+                throw std::runtime_error("binary fuse filter file has invalid parameters");
+
+            std::vector<size_t> parameters;
+            detail::read_salts(in, header, parameters);
+
+            binary_fuse_filter filter (parameters[0], parameters[1], parameters[2],
+                    parameters[3], parameters[4]);
+            size_t const array_length = header.num_bits / fingerprint_bits;
+            if (array_length != 0 and (filter.m_segment_length == 0
+                    or (filter.m_segment_length & (filter.m_segment_length - 1)) != 0
+                    or filter.m_segment_count_length % filter.m_segment_length != 0
+                    or filter.m_segment_count_length + (arity - 1) * filter.m_segment_length
+                        != array_length))
+                throw std::runtime_error("binary fuse filter file has an inconsistent layout");
+
+            filter.m_fingerprints.resize(array_length);
+            if (not in.read(reinterpret_cast<char*>(filter.m_fingerprints.data()), header.data_size))
+                throw std::runtime_error("bloom filter file is truncated");
+            return filter;
+        };
+
+    private:
+        /**
+         * Number of parameter words saved in place of salt values: salt,
+         * seed, segment length, segment count length and size.
+         */
+        static constexpr size_t const num_parameters = 5;
+
+        /**
+         * Largest segment length.
+         */
+        static constexpr size_t const max_segment_length = size_t{1} << 18;
+
+        /**
+         * Constructor. Restores the parameters of a saved filter; the
+         * fingerprints are read by the caller.
+         */
+        binary_fuse_filter(size_t const salt, std::uint64_t const seed,
+                size_t const segment_length, size_t const segment_count_length,
+                size_t const size)
+        :   m_hash_function(salt),
+            m_seed(seed),
+            m_segment_length(segment_length),
+            m_segment_count_length(segment_count_length),
+            m_size(size),
+            m_fingerprints()
+        {
+            // ctor
+        }
+
+        /**
+         * Build the header of a saved filter.
+         *
+         * \param num_bits      Number of bits of the filter
+         * \param num_salts     Number of parameter words
+         * \return              Header
+         */
+        static detail::file_header make_header(std::uint64_t const num_bits,
+                std::uint64_t const num_salts)
+        {
+            return detail::make_header(detail::file_header::kind_binary_fuse, 0,
+                    detail::hasher_id<hasher>::value, num_bits, arity, num_salts, num_bits / 8);
+        }
+
+        /**
+         * Hash the keys, splitting them evenly among the threads.
+         *
+         * \param first         Iterator to the first key
+         * \param hashes        Output, one hash per key, sized by the caller
+         * \param num_threads   Number of threads to use at most
+         */
+        template<typename iterator_t>
+        void hash_keys(iterator_t first, std::vector<std::uint64_t>& hashes,
+                size_t const num_threads) const
+        {
+            size_t const n = hashes.size();
+            size_t const threads = std::max<size_t>(1,
+                    std::min(num_threads, n / min_keys_per_thread));
+
+            auto const hash_range = [this, &hashes](iterator_t it, size_t const begin, size_t const end)
+            {
+                for (size_t i = begin; i < end; ++i, ++it)
+                {
+                    hashes[i] = m_hash_function.hash(*it);
+                }
+            };
+
+            std::vector<std::thread> workers;
+            size_t begin = 0;
+            for (size_t t = 1; t < threads; ++t)
+            {
+                size_t const end = n * t / threads;
+                workers.emplace_back(hash_range, first, begin, end);
+                std::advance(first, end - begin);
+                begin = end;
+            }
+            hash_range(first, begin, n);
+            for (auto& worker : workers) worker.join();
+        }
+
+        /**
+         * Choose the segment length and number of segments for a number of
+         * keys, following the reference implementation.
+         *
+         * \param size  Number of keys
+         * \return      Number of slots
+         */
+        size_t layout(size_t const size)
+        {
+            if (size == 0)
+            {
+                m_segment_length = 4;
+                m_segment_count_length = 0;
+                return 0;
+            }
+
+            m_segment_length = std::min(max_segment_length, size_t{1} << static_cast<int>(
+                        std::floor(std::log(static_cast<double>(size)) / std::log(3.33) + 2.25)));
+
+            double const size_factor = size <= 1 ? 0 : std::max(1.125,
+                    0.875 + 0.25 * std::log(1e6) / std::log(static_cast<double>(size)));
+            auto const capacity = static_cast<size_t>(std::round(size * size_factor));
+            size_t const segments = (capacity + m_segment_length - 1) / m_segment_length;
+            size_t const segment_count = segments <= arity - 1 ? 1 : segments - (arity - 1);
+
+            m_segment_count_length = segment_count * m_segment_length;
+            return m_segment_count_length + (arity - 1) * m_segment_length;
+        }
+
+        /**
+         * Mix the hash of a key with the seed of the filter.
+         */
+        std::uint64_t mix(std::uint64_t const hash) const
+        {
+            return detail::mix64(hash + m_seed);
+        }
+
+        /**
+         * The slots of a mixed hash, one in each of three consecutive
+         * segments. The first segment is picked from the high bits, the
+         * offsets within the other two from the low bits.
+         *
+         * \param hash  Mixed hash
+         * \return      Slots
+         */
+        std::array<size_t, arity> positions(std::uint64_t const hash) const
+        {
+            size_t const mask = m_segment_length - 1;
+            size_t const h0 = detail::fast_range(hash, m_segment_count_length);
+            size_t const h1 = (h0 + m_segment_length) ^ ((hash >> 18) & mask);
+            size_t const h2 = (h0 + 2 * m_segment_length) ^ (hash & mask);
+            return { h0, h1, h2 };
+        }
+
+        /**
+         * \param hash  Mixed hash
+         * \return      Fingerprint of the hash
+         */
+        static fingerprint_t fingerprint(std::uint64_t const hash)
+        {
+            return static_cast<fingerprint_t>(hash ^ (hash >> 32));
+        }
+
+        /**
+         * \param hash  Mixed hash
+         * \return      Whether the slots of the hash xor to its fingerprint
+         */
+        bool contains(std::uint64_t const hash) const
+        {
+            auto const h = positions(hash);
+            return (fingerprint(hash) ^ m_fingerprints[h[0]] ^ m_fingerprints[h[1]]
+                    ^ m_fingerprints[h[2]]) == 0;
+        }
+
+        /**
+         * Try to place all keys with a seed. Every slot counts its keys and
+         * xors their hashes, so a slot with a single key knows it. Such keys
+         * are peeled off repeatedly; when all are peeled, the fingerprints
+         * are assigned in reverse peeling order, each key getting the slot
+         * no later key touches.
+         *
+         * \param hashes    Hashes of the keys
+         * \param seed      Seed to try
+         * \return          Whether all keys were placed
+         */
+        bool populate(std::vector<std::uint64_t> const& hashes, std::uint64_t const seed)
+        {
+            m_seed = seed;
+            size_t const size = hashes.size();
+            size_t const array_length = m_fingerprints.size();
+
+            // sort the hashes roughly by their first slot, so that counting
+            // walks the slots in order instead of jumping around
+            size_t const segment_count = m_segment_count_length / m_segment_length;
+            size_t block_bits = 1;
+            while ((size_t{1} << block_bits) < segment_count) ++block_bits;
+            size_t const block_mask = (size_t{1} << block_bits) - 1;
+
+            std::vector<size_t> start_pos (size_t{1} << block_bits);
+            for (size_t i = 0; i < start_pos.size(); ++i) start_pos[i] = (i * size) >> block_bits;
+
+            // zero marks a free entry, the entry past the end is never free
+            std::vector<std::uint64_t> order (size + 1);
+            order[size] = 1;
+            for (std::uint64_t const h : hashes)
+            {
+                std::uint64_t const hash = mix(h);
+                // the one key that mixes to zero can not be placed with this seed
+                if (hash == 0) return false;
+
+                size_t block = hash >> (64 - block_bits);
+                while (order[start_pos[block]] != 0) block = (block + 1) & block_mask;
+                order[start_pos[block]++] = hash;
+            }
+
+            // per slot, the number of keys times four plus the xor of the
+            // key's position among its three slots, and the xor of the hashes
+            std::vector<std::uint8_t> count (array_length);
+            std::vector<std::uint64_t> xors (array_length);
+            for (size_t i = 0; i < size; ++i)
+            {
+                std::uint64_t const hash = order[i];
+                auto const h = positions(hash);
+                for (size_t j = 0; j < arity; ++j)
+                {
+                    count[h[j]] += 4;
+                    count[h[j]] ^= j;
+                    xors[h[j]] ^= hash;
+                }
+
+                // more than 63 keys in a slot overflow its count
+                if (count[h[0]] < 4 or count[h[1]] < 4 or count[h[2]] < 4) return false;
+            }
+
+            std::vector<size_t> alone (array_length + 1);
+            size_t queue_size = 0;
+            for (size_t i = 0; i < array_length; ++i)
+            {
+                alone[queue_size] = i;
+                queue_size += (count[i] >> 2) == 1;
+            }
+
+            // peeled hashes reuse the front of order, which is no longer read
+            std::vector<std::uint8_t> peeled_slot (size);
+            size_t stack_size = 0;
+            while (queue_size > 0)
+            {
+                size_t const index = alone[--queue_size];
+                if ((count[index] >> 2) != 1) continue;
+
+                std::uint64_t const hash = xors[index];
+                auto const h = positions(hash);
+                std::uint8_t const found = count[index] & 3;
+                peeled_slot[stack_size] = found;
+                order[stack_size] = hash;
+                ++stack_size;
+
+                for (size_t j = 1; j < arity; ++j)
+                {
+                    size_t const slot = (found + j) % arity;
+                    size_t const other = h[slot];
+                    alone[queue_size] = other;
+                    queue_size += (count[other] >> 2) == 2;
+                    count[other] -= 4;
+                    count[other] ^= slot;
+                    xors[other] ^= hash;
+                }
+            }
+            if (stack_size != size) return false;
+
+            std::fill(m_fingerprints.begin(), m_fingerprints.end(), 0);
+            for (size_t i = stack_size; i-- > 0;)
+            {
+                std::uint64_t const hash = order[i];
+                auto const h = positions(hash);
+                size_t const found = peeled_slot[i];
+                m_fingerprints[h[found]] = fingerprint(hash)
+                    ^ m_fingerprints[h[(found + 1) % arity]]
+                    ^ m_fingerprints[h[(found + 2) % arity]];
+            }
+            m_size = stack_size;
+            return true;
+        }
+
+        /**
+         * Hash function of the keys, before mixing with the seed.
+         */
+        detail::hash_fn<T, hasher> m_hash_function;
+
+        /**
+         * Seed that placed all keys.
+         */
+        std::uint64_t m_seed;
+
+        /**
+         * Number of slots per segment, a power of two.
+         */
+        size_t m_segment_length;
+
+        /**
+         * Number of slots in the segments a key's first slot can be in.
+         */
+        size_t m_segment_count_length;
+
+        /**
+         * Number of distinct keys.
+         */
+        size_t m_size;
+
+        /**
+         * The fingerprint slots.
+         */
+        std::vector<fingerprint_t> m_fingerprints;
+};
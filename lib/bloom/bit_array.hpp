@@ -0,0 +1,404 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "word_kernels.hpp"
+
+#pragma once
+
+namespace detail
+{
+    /**
+     * Size of a cache line in bytes. All storage is aligned to (and padded
+     * to a multiple of) this size.
+     */
+    constexpr size_t const cache_line_size = 64;
+
+    /**
+     * Size of a transparent huge page in bytes. Allocations on the huge page
+     * path are rounded up to a multiple of this.
+     */
+    constexpr size_t const huge_page_size = 2ul << 20;
+
+    /**
+     * Number of bytes to allocate for a payload: the payload rounded up to a
+     * cache line, or to a huge page on the huge page path.
+     *
+     * \param bytes         Size of the payload
+     * \param huge_pages    Whether the storage is on the huge page path
+     * \return              Size of the allocation
+     */
+    inline size_t storage_size(size_t const bytes, bool const huge_pages)
+    {
+        size_t const granularity = huge_pages ? huge_page_size : cache_line_size;
+        return std::max(granularity,
+                (bytes + granularity - 1) / granularity * granularity);
+    }
+
+    /**
+     * Allocate zeroed, cache-line-aligned storage.
+     *
+     * \param bytes         Size of the allocation, see
+     *                      <code>storage_size</code>
+     * \param huge_pages    Whether to try to back the storage with huge
+     *                      pages. Set to false if the platform has no huge
+     *                      page path.
+     * \return              Pointer to the storage
+     */
+    inline void* allocate_storage(size_t const bytes, bool& huge_pages)
+    {
+#if defined(__linux__)
+        if (huge_pages)
+        {
+            void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) throw std::bad_alloc();
+#if defined(MADV_HUGEPAGE)
+            // advisory only, failure just means regular pages
+            madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+            return p;
+        }
+#else
+        huge_pages = false;
+#endif
+        void* p = std::aligned_alloc(cache_line_size, bytes);
+        if (p == nullptr) throw std::bad_alloc();
+        std::memset(p, 0, bytes);
+        return p;
+    }
+
+    /**
+     * Release storage obtained from <code>allocate_storage</code>.
+     *
+     * \param p             Pointer to the storage
+     * \param bytes         Size of the allocation
+     * \param huge_pages    Whether the storage is on the huge page path
+     */
+    inline void deallocate_storage(void* p, size_t const bytes, bool const huge_pages)
+    {
+#if defined(__linux__)
+        if (huge_pages)
+        {
+            munmap(p, bytes);
+            return;
+        }
+#endif
+        (void) bytes;
+        (void) huge_pages;
+        std::free(p);
+    }
+
+    /**
+     * Hint the CPU to fetch the cache line holding an address, to be read.
+     *
+     * \param p     Address
+     */
+    inline void prefetch_read(void const* p)
+    {
+        __builtin_prefetch(p, 0, 3);
+    }
+
+    /**
+     * Hint the CPU to fetch the cache line holding an address, to be
+     * written.
+     *
+     * \param p     Address
+     */
+    inline void prefetch_write(void const* p)
+    {
+        __builtin_prefetch(p, 1, 3);
+    }
+
+    /**
+     * Heap-allocated, runtime-sized array of bits. The bits are stored in
+     * 64-bit words in a single cache-line-aligned allocation, so objects of
+     * this class are small regardless of the number of bits and can live on
+     * the stack.
+     *
+     * Optionally the storage can be requested to be backed by huge pages.
+     * This is a hint only: if the platform does not support it, regular
+     * pages are used.
+     *
+     * A bit array can also view storage it does not own, such as a memory
+     * mapped file. Such an array never frees the storage, and copies of it
+     * own their own storage again.
+     */
+    class bit_array
+    {
+        public:
+            using word_t = std::uint64_t;
+
+            /**
+             * Number of bits in one storage word.
+             */
+            static constexpr size_t const word_bits = 8 * sizeof(word_t);
+
+            /**
+             * Constructor. All bits are initially unset.
+             *
+             * \param num_bits      Number of bits to store
+             * \param huge_pages    Whether to try to back the storage with
+             *                      huge pages
+             */
+            explicit bit_array(size_t const num_bits, bool const huge_pages = false)
+            :   m_words(nullptr),
+                m_num_bits(num_bits),
+                m_num_words((num_bits + word_bits - 1) / word_bits),
+                m_huge_pages(huge_pages),
+                m_borrowed(false)
+            {
+                allocate();
+            }
+
+            /**
+             * Constructor. Views external storage instead of allocating. The
+             * storage must stay valid for the lifetime of this object; it is
+             * not freed.
+             *
+             * \param words     Storage of at least
+             *                  <code>(num_bits + word_bits - 1) / word_bits</code>
+             *                  words
+             * \param num_bits  Number of bits stored
+             */
+            bit_array(word_t* words, size_t const num_bits)
+            :   m_words(words),
+                m_num_bits(num_bits),
+                m_num_words((num_bits + word_bits - 1) / word_bits),
+                m_huge_pages(false),
+                m_borrowed(true)
+            {
+                // ctor
+            }
+
+            bit_array() : bit_array(0) {};
+
+            /**
+             * Copy constructor.
+             *
+             * \param other     Other bit_array object
+             */
+            bit_array(bit_array const& other)
+            :   m_words(nullptr),
+                m_num_bits(other.m_num_bits),
+                m_num_words(other.m_num_words),
+                m_huge_pages(other.m_huge_pages),
+                m_borrowed(false)
+            {
+                allocate();
+                std::memcpy(m_words, other.m_words, m_num_words * sizeof(word_t));
+            }
+
+            /**
+             * Move constructor.
+             *
+             * \param other     Other bit_array object (moved from)
+             */
+            bit_array(bit_array&& other) noexcept
+            :   m_words(std::exchange(other.m_words, nullptr)),
+                m_num_bits(std::exchange(other.m_num_bits, 0)),
+                m_num_words(std::exchange(other.m_num_words, 0)),
+                m_huge_pages(other.m_huge_pages),
+                m_borrowed(other.m_borrowed)
+            {
+                // ctor
+            }
+
+            /**
+             * Copy and move assignment operator.
+             *
+             * \param other     Other bit_array object
+             * \return          A reference to this
+             */
+            bit_array& operator= (bit_array other) noexcept
+            {
+                std::swap(m_words, other.m_words);
+                std::swap(m_num_bits, other.m_num_bits);
+                std::swap(m_num_words, other.m_num_words);
+                std::swap(m_huge_pages, other.m_huge_pages);
+                std::swap(m_borrowed, other.m_borrowed);
+
+                return *this;
+            }
+
+            /**
+             * Destructor.
+             */
+            ~bit_array()
+            {
+                deallocate();
+            }
+
+            /**
+             * Set a bit.
+             *
+             * \param idx   Index of the bit
+             */
+            void set(size_t const idx)
+            {
+                m_words[idx / word_bits] |= word_t{1} << (idx % word_bits);
+            }
+
+            /**
+             * Test a bit.
+             *
+             * \param idx   Index of the bit
+             * \return      Whether the bit is set
+             */
+            bool test(size_t const idx) const
+            {
+                return (m_words[idx / word_bits] >> (idx % word_bits)) & 1u;
+            }
+
+            /**
+             * Prefetch the word holding a bit, to be read.
+             *
+             * \param idx   Index of the bit
+             */
+            void prefetch_read(size_t const idx) const
+            {
+                detail::prefetch_read(m_words + idx / word_bits);
+            }
+
+            /**
+             * Prefetch the word holding a bit, to be written.
+             *
+             * \param idx   Index of the bit
+             */
+            void prefetch_write(size_t const idx) const
+            {
+                detail::prefetch_write(m_words + idx / word_bits);
+            }
+
+            /**
+             * Unset all bits.
+             */
+            void reset()
+            {
+                std::memset(m_words, 0, m_num_words * sizeof(word_t));
+            }
+
+            /**
+             * Set all bits that are set in another array of the same size.
+             *
+             * \param other     Other bit_array object
+             */
+            void or_with(bit_array const& other)
+            {
+                words::select().bitwise_or(m_words, other.m_words, m_num_words);
+            }
+
+            /**
+             * Unset all bits that are unset in another array of the same
+             * size.
+             *
+             * \param other     Other bit_array object
+             */
+            void and_with(bit_array const& other)
+            {
+                words::select().bitwise_and(m_words, other.m_words, m_num_words);
+            }
+
+            /**
+             * \param other     Other bit_array object
+             * \return          Whether both arrays have the same size and bits
+             */
+            bool equals(bit_array const& other) const
+            {
+                return m_num_bits == other.m_num_bits
+                    and words::select().equal(m_words, other.m_words, m_num_words);
+            }
+
+            /**
+             * Count the set bits with the fastest kernel the CPU supports.
+             * The bits past <code>size()</code> in the last word are never
+             * set, so they do not count.
+             *
+             * \return      Number of set bits
+             */
+            size_t count() const
+            {
+                return words::select_popcount()(m_words, m_num_words);
+            }
+
+            /**
+             * \return      Number of bits stored
+             */
+            size_t size() const { return m_num_bits; }
+
+            /**
+             * \return      Number of storage words
+             */
+            size_t num_words() const { return m_num_words; }
+
+            /**
+             * \return      Pointer to the first storage word
+             */
+            word_t* data() { return m_words; }
+
+            /**
+             * \return      Pointer to the first storage word
+             */
+            word_t const* data() const { return m_words; }
+
+        private:
+            /**
+             * \return      Number of bytes allocated for the storage words
+             */
+            size_t allocation_size() const
+            {
+                return storage_size(m_num_words * sizeof(word_t), m_huge_pages);
+            }
+
+            /**
+             * Allocate zeroed storage for <code>m_num_words</code> words.
+             */
+            void allocate()
+            {
+                m_words = static_cast<word_t*>(allocate_storage(allocation_size(), m_huge_pages));
+            }
+
+            /**
+             * Release the storage, if any and if owned.
+             */
+            void deallocate()
+            {
+                if (m_words == nullptr or m_borrowed) return;
+                deallocate_storage(m_words, allocation_size(), m_huge_pages);
+            }
+
+            /**
+             * Pointer to the storage words.
+             */
+            word_t* m_words;
+
+            /**
+             * Number of bits stored.
+             */
+            size_t m_num_bits;
+
+            /**
+             * Number of storage words, i.e. <code>m_num_bits</code> rounded
+             * up to a multiple of <code>word_bits</code>.
+             */
+            size_t m_num_words;
+
+            /**
+             * Whether the storage is on the huge page path.
+             */
+            bool m_huge_pages;
+
+            /**
+             * Whether the storage is owned by someone else.
+             */
+            bool m_borrowed;
+    }; // class bit_array
+} // namespace detail
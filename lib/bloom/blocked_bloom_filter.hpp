@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+
+#include "bit_array.hpp"
+#include "index_generator.hpp"
+
+#pragma once
+
+/**
+ * Cache-line-blocked bloom filter. The bits are split into blocks of one
+ * cache line each. One extra index selects a block, and all
+ * <code>num_hash_functions</code> bits of a value are set inside that block,
+ * so adding or testing a value touches a single cache line.
+ *
+ * On filters much larger than the last level cache this reduces a lookup
+ * from up to <code>num_hash_functions</code> memory misses to one. The price
+ * is a slightly higher false positive rate than a
+ * <code>dynamic_bloom_filter</code> with the same number of bits, because the
+ * load of the blocks varies. Adding about one hash function or a few percent
+ * of bits compensates for this in practice.
+ *
+ * Thread safety: as for <code>dynamic_bloom_filter</code>, any number of
+ * threads may call the const member functions concurrently.
+ *
+ * \param T         Template parameter for the type to build the filter for.
+ * \param hashing   Hashing scheme, <code>independent_hashing</code> or
+ *                  <code>double_hashing</code>.
+ * \param hasher    Hasher, e.g. <code>wyhash_hasher</code> or
+ *                  <code>std_hasher</code>.
+ */
+template<typename T, typename hashing = independent_hashing,
+    typename hasher = wyhash_hasher>
+class blocked_bloom_filter
+{
+    public:
+        using word_t = detail::bit_array::word_t;
+
+        /**
+         * Number of bits in one block.
+         */
+        static constexpr size_t const block_bits = 8 * detail::cache_line_size;
+
+        /**
+         * Number of storage words in one block.
+         */
+        static constexpr size_t const block_words = block_bits / detail::bit_array::word_bits;
+
+        /**
+         * Number of values hashed ahead in <code>add_batch</code> and
+         * <code>test_batch</code>. The memory accesses of all their blocks
+         * are in flight at the same time.
+         */
+        static constexpr size_t const batch_window = 16;
+
+        /**
+         * Constructor. Derives the salt values of all hash functions from the
+         * default seed.
+         *
+         * \param num_bits              Number of bits in the filter, rounded
+         *                              up to a multiple of
+         *                              <code>block_bits</code>
+         * \param num_hash_functions    Number of hash functions (and thus
+         *                              bits set in the block) per value
+         * \param huge_pages            Whether to try to back the bits with
+         *                              huge pages
+         */
+        blocked_bloom_filter(size_t const num_bits,
+                size_t const num_hash_functions,
+                bool const huge_pages = false)
+        :   m_indices(num_hash_functions + 1),
+            m_num_blocks((num_bits + block_bits - 1) / block_bits),
+            m_hash_hits(m_num_blocks * block_bits, huge_pages)
+        {
+            if (num_bits == 0)
+                throw std::invalid_argument("bloom filter needs at least one bit");
+            if (num_hash_functions == 0)
+                throw std::invalid_argument("bloom filter needs at least one hash function");
+        };
+
+        /**
+         * Destructor.
+         */
+        ~blocked_bloom_filter() = default;
+
+        /**
+         * Add a value to the filter. This selects the block with the first
+         * index and sets one bit per hash function inside it.
+         *
+         * \param t     Value to add
+         */
+        void add(T const& t)
+        {
+            auto const hashed = m_indices.hash(t);
+            word_t* block = m_hash_hits.data() + first_word(hashed);
+            for (size_t i = 1; i < m_indices.size(); ++i)
+            {
+                set(block, hashed.index(i, block_bits));
+            }
+        };
+
+        /**
+         * Test whether a value is in the filter. The return value
+         * <code>false</code> means that the value is <i>guaranteed</i> not to
+         * be in the filter. The return value <code>true</code> means that the
+         * value <i>maybe</i> is in the set.
+         *
+         * \param t     Data item to check for
+         * \return      Boolean value indicating membership
+         */
+        bool test(T const& t) const
+        {
+            auto const hashed = m_indices.hash(t);
+            word_t const* block = m_hash_hits.data() + first_word(hashed);
+            for (size_t i = 1; i < m_indices.size(); ++i)
+            {
+                if (not is_set(block, hashed.index(i, block_bits))) return false;
+            }
+            return true;
+        };
+
+        /**
+         * Add several values to the filter. This has the same effect as
+         * calling <code>add</code> for every value, but hashes
+         * <code>batch_window</code> values ahead and prefetches their blocks,
+         * so that the cache misses overlap.
+         *
+         * \param values    Pointer to the first value
+         * \param count     Number of values
+         */
+        void add_batch(T const* values, size_t const count)
+        {
+            window_t window;
+            for (size_t first = 0; first < count; first += batch_window)
+            {
+                size_t const n = std::min(batch_window, count - first);
+                hash_window(values + first, n, window, true);
+                for (size_t v = 0; v < n; ++v)
+                {
+                    for (size_t w = 0; w < block_words; ++w)
+                    {
+                        m_hash_hits.data()[window.blocks[v] + w] |= window.masks[v][w];
+                    }
+                }
+            }
+        };
+
+        /**
+         * Test several values for membership. This has the same effect as
+         * calling <code>test</code> for every value, but hashes
+         * <code>batch_window</code> values ahead and prefetches their blocks,
+         * so that the cache misses overlap.
+         *
+         * \param values    Pointer to the first value
+         * \param count     Number of values
+         * \param results   Bitmap of at least <code>(count + 63) / 64</code>
+         *                  words. Bit <code>i % 64</code> of word
+         *                  <code>i / 64</code> is set to the result for the
+         *                  i-th value; the other bits of the last word are
+         *                  cleared.
+         */
+        void test_batch(T const* values, size_t const count, std::uint64_t* results) const
+        {
+            std::fill(results, results + (count + 63) / 64, 0);
+
+            window_t window;
+            for (size_t first = 0; first < count; first += batch_window)
+            {
+                size_t const n = std::min(batch_window, count - first);
+                hash_window(values + first, n, window, false);
+                for (size_t v = 0; v < n; ++v)
+                {
+                    word_t missing = 0;
+                    for (size_t w = 0; w < block_words; ++w)
+                    {
+                        missing |= window.masks[v][w] & ~m_hash_hits.data()[window.blocks[v] + w];
+                    }
+                    size_t const pos = first + v;
+                    results[pos / 64] |= std::uint64_t{missing == 0} << (pos % 64);
+                }
+            }
+        };
+
+        /**
+         * \return      Number of bits in the filter
+         */
+        size_t num_bits() const { return m_hash_hits.size(); }
+
+        /**
+         * \return      Number of blocks in the filter
+         */
+        size_t num_blocks() const { return m_num_blocks; }
+
+        /**
+         * \return      Number of hash functions used per value
+         */
+        size_t num_hash_functions() const { return m_indices.size() - 1; }
+
+    private:
+        /**
+         * Hashed value type of the index generator.
+         */
+        using hashed_t = typename detail::index_generator<T, hashing, hasher>::hashed;
+
+        /**
+         * A window of hashed values for the batch operations: the index of
+         * the first word of the block of each value, and the bits of the
+         * value within its block as a mask.
+         */
+        struct window_t
+        {
+            std::array<size_t, batch_window> blocks;
+            std::array<std::array<word_t, block_words>, batch_window> masks;
+        };
+
+        /**
+         * Hash a window of values, prefetch their blocks and build their
+         * masks.
+         *
+         * \param values    Pointer to the first value
+         * \param n         Number of values, at most
+         *                  <code>batch_window</code>
+         * \param window    Output, blocks and masks of the values
+         * \param write     Whether the blocks will be written
+         */
+        void hash_window(T const* values, size_t const n, window_t& window, bool const write) const
+        {
+            for (size_t v = 0; v < n; ++v)
+            {
+                auto const hashed = m_indices.hash(values[v]);
+                window.blocks[v] = first_word(hashed);
+                word_t const* block = m_hash_hits.data() + window.blocks[v];
+                if (write) detail::prefetch_write(block);
+                else detail::prefetch_read(block);
+
+                window.masks[v].fill(0);
+                for (size_t i = 1; i < m_indices.size(); ++i)
+                {
+                    set(window.masks[v].data(), hashed.index(i, block_bits));
+                }
+            }
+        }
+
+        /**
+         * Select the block for a value.
+         *
+         * \param hashed    Hashed value
+         * \return          Index of the first word of the block
+         */
+        size_t first_word(hashed_t const& hashed) const
+        {
+            return hashed.index(0, m_num_blocks) * block_words;
+        }
+
+        /**
+         * Set a bit inside a block.
+         *
+         * \param block     Pointer to the first word of the block
+         * \param bit       Index of the bit inside the block
+         */
+        static void set(word_t* block, size_t const bit)
+        {
+            block[bit / detail::bit_array::word_bits] |=
+                word_t{1} << (bit % detail::bit_array::word_bits);
+        }
+
+        /**
+         * Test a bit inside a block.
+         *
+         * \param block     Pointer to the first word of the block
+         * \param bit       Index of the bit inside the block
+         * \return          Whether the bit is set
+         */
+        static bool is_set(word_t const* block, size_t const bit)
+        {
+            return (block[bit / detail::bit_array::word_bits]
+                    >> (bit % detail::bit_array::word_bits)) & 1u;
+        }
+
+        /**
+         * Computes the indices of a value: the first selects the block, the
+         * others one bit inside the block each.
+         */
+        detail::index_generator<T, hashing, hasher> m_indices;
+
+        /**
+         * Number of blocks in the filter.
+         */
+        size_t m_num_blocks;
+
+        /**
+         * The bits set by hash function hits, <code>m_num_blocks</code>
+         * cache-line-aligned blocks of <code>block_bits</code> bits each.
+         */
+        detail::bit_array m_hash_hits;
+};
@@ -1,14 +1,12 @@
-#include <algorithm>
-#include <array>
-#include <bitset>
 #include <cstdint>
-#include <cstring>
-#include <functional>
+#include <istream>
 #include <limits>
-#include <random>
-#include <type_traits>
+#include <stdexcept>
+#include <utility>
 
-#include "hash_fn.hpp"
+#include "dynamic_bloom_filter.hpp"
+#include "index_generator.hpp"
+#include "parameters.hpp"
 
 #pragma once
 
@@ -27,9 +25,9 @@
  *
  * The <code>num_hash_functions</code> and <code>hash_precision</code>
  * parameters can be tuned for a good compromise between precision of tests
- * (few false positives) and storage and runtime. The rule for good
- * <code>std::hash</code> implementations is that for a desired false positive
- * rate <i>p</i> and a number of inserted elements <i>n</i> we have:
+ * (few false positives) and storage and runtime. For a desired false
+ * positive rate <i>p</i> and a number of inserted elements <i>n</i> the
+ * optimal number of bits <i>m</i> and hash functions are:
  *
  * \f[
  *      \mathrm{num\_hash\_functions} = -\log_2(p)
@@ -38,9 +36,24 @@
  * and
  *
  * \f[
- *      \mathrm{hash\_precision} = \frac{n \cdot \ln(p)}{\left( \ln(2) \right)^2}
+ *      m = -\frac{n \cdot \ln(p)}{\left( \ln(2) \right)^2},
+ *      \quad \mathrm{hash\_precision} = \lceil \log_2(m) \rceil
  * \f]
  *
+ * Rounding the number of bits up to a power of two wastes up to half of the
+ * memory. <code>optimal_parameters</code> computes the exact optimum, at
+ * compile time if needed, for a <code>sized_bloom_filter</code> or a
+ * <code>dynamic_bloom_filter</code>. Filters of at most 512 bits, e.g.
+ * one per row of a table, are much cheaper as a
+ * <code>small_bloom_filter</code>, which keeps its bits in place and hashes
+ * with compile-time constants.
+ *
+ * Once built, a filter can be shared between any number of reader threads
+ * through a <code>const</code> reference: <code>test</code> is const and
+ * does not modify any state, so concurrent tests need no locks. Adding values
+ * concurrently with other operations is not safe, see
+ * <code>concurrent_bloom_filter</code> for that.
+ *
  * \param T             Template parameter for the type to build the filter for.
  * \param num_hash_functions The number of hash functions to use for fingerprints.
  * \param hash_precision    The number of bits to use for the fingerprints.
@@ -48,31 +61,54 @@
  * (many false positives). Also keep in mind using many bits will drastically
  * increase the storage requirements of objects of this class. The hash
  * precision may not be more precise than the number of bits in a
- * <code>size_t</code> for obvious reasons.
+ * <code>size_t</code> for obvious reasons. For filters whose size is only
+ * known at runtime, or is not a power of two, use
+ * <code>dynamic_bloom_filter</code>.
+ * \param hashing   Hashing scheme. With <code>independent_hashing</code> (the
+ * default) the value is hashed once per hash function. With
+ * <code>double_hashing</code> it is hashed only once and all indices are
+ * derived from a 128-bit hash, which is much cheaper for e.g. long strings.
+ * \param hasher    Hasher. The default <code>wyhash_hasher</code> hashes
+ * strings and integers itself and falls back to <code>std::hash</code> for
+ * other types; <code>std_hasher</code> always uses <code>std::hash</code>.
+ * \param instrumentation   Instrumentation policy. The default
+ * <code>no_instrumentation</code> costs nothing; with
+ * <code>counting_instrumentation</code> the filter counts its operations,
+ * see <code>dynamic_bloom_filter::statistics</code>.
  */
-template<typename T, size_t num_hash_functions, size_t hash_precision>
-class bloom_filter
+template<typename T, size_t num_hash_functions, size_t hash_precision,
+    typename hashing = independent_hashing, typename hasher = wyhash_hasher,
+    typename instrumentation = no_instrumentation>
+class bloom_filter : public dynamic_bloom_filter<T, hashing, hasher, instrumentation>
 {
     public:
+        /*
+         * Assert that the filter can be indexed with a size_t.
+         */
+        static_assert(hash_precision < std::numeric_limits<size_t>::digits,
+                "Hash precision must be less than the amount of bits in size_t.");
+
         /**
-         * Constructor. Initializes all hash function with (pseudo)random salt
-         * values.
+         * Constructor. Derives the salt values of all hash functions from the
+         * default seed. The bits are allocated on the heap, so filters of any
+         * size can be constructed on the stack.
          */
         bloom_filter()
-        :   m_hash_functions(),
-            m_hash_hits()
+        :   base_t(1ul << hash_precision, num_hash_functions)
         {
-            // choose salt uniform at random from [ 0, 2^{63} ]
-            std::default_random_engine generator;
-            std::uniform_int_distribution<size_t> distribution (
-                    0,
-                    std::numeric_limits<size_t>::max()
-                );
-            for (size_t i = 0; i < num_hash_functions; ++i)
-            {
-                auto const salt { distribution(generator) };
-                m_hash_functions[i] = detail::hash_fn<hash_precision, T>(salt);
-            }
+            // ctor
+        };
+
+        /**
+         * Constructor. Derives the salt values of all hash functions from a
+         * seed.
+         *
+         * \param seed  Seed of the salt values
+         */
+        explicit bloom_filter(filter_seed const seed)
+        :   base_t(1ul << hash_precision, num_hash_functions, seed)
+        {
+            // ctor
         };
 
         /**
@@ -81,59 +117,119 @@ class bloom_filter
         ~bloom_filter() = default;
 
         /**
-         * Add a value to the filter. This hashes the value with all hash
-         * functions and sets the respective bits in the bitset.
+         * Read a filter written by <code>save</code> from a stream. The
+         * filter must have been saved with the same parameters.
          *
-         * \param t     Value to add
+         * \param in    Stream to read from
+         * \return      The filter
+         * \throw std::runtime_error if the stream does not hold a matching
+         *              filter
          */
-        void add(T const& t)
+        static bloom_filter load(std::istream& in)
         {
-            // reduce to sizeof(size_t) bytes
-            for (auto& fn : m_hash_functions)
-            {
-                auto hash = fn(t);
-                m_hash_hits.set(hash.to_ulong());
-            }
+            return bloom_filter(base_t::load(in));
         };
 
+    private:
+        using base_t = dynamic_bloom_filter<T, hashing, hasher, instrumentation>;
+
         /**
-         * Test whether a value is in the filter. The return value
-         * <code>false</code> means that the value is <i>guaranteed</i> not to
-         * be in the filter. The return value <code>true</code> means that the
-         * value <i>maybe</i> is in the set.
+         * Constructor. Takes over a loaded filter after checking its
+         * parameters.
          *
-         * \param t     Data item to check for
-         * \return      Boolean value indicating membership
+         * \param filter    Loaded filter
          */
-        bool test(T const& t)
+        explicit bloom_filter(base_t&& filter)
+        :   base_t(std::move(filter))
         {
-            // t may be member if the indices of all hashes of the value are
-            // set in the bitset
-            return std::all_of(
-                    m_hash_functions.begin(),
-                    m_hash_functions.end(),
-                    [&](auto& fn)
-                    {
-                        auto hash = fn(t);
-                        return m_hash_hits.test(hash.to_ulong());
-                    }
-                );
+            if (this->num_bits() != (1ul << hash_precision)
+                    or this->num_hash_functions() != num_hash_functions)
+                throw std::runtime_error("filter was saved with different parameters");
+        };
+};
+
+/**
+ * Bloom filter with a number of bits and hash functions that are fixed at
+ * compile time, like <code>bloom_filter</code>, but with any number of bits
+ * instead of a power of two. Use <code>optimal_parameters</code> to size it
+ * for a number of values and a false positive rate:
+ * \code
+ *      constexpr auto params = optimal_parameters(1000000, 0.01);
+ *      sized_bloom_filter<int, params.num_bits, params.num_hash_functions> filter;
+ * \endcode
+ *
+ * \param T                     Template parameter for the type to build the
+ *                              filter for.
+ * \param num_bits              Number of bits in the filter.
+ * \param num_hash_functions    Number of hash functions to use.
+ * \param hashing               Hashing scheme, see <code>bloom_filter</code>.
+ * \param hasher                Hasher, see <code>bloom_filter</code>.
+ * \param instrumentation       Instrumentation policy, see
+ *                              <code>bloom_filter</code>.
+ */
+template<typename T, size_t num_bits, size_t num_hash_functions,
+    typename hashing = independent_hashing, typename hasher = wyhash_hasher,
+    typename instrumentation = no_instrumentation>
+class sized_bloom_filter : public dynamic_bloom_filter<T, hashing, hasher, instrumentation>
+{
+    public:
+        static_assert(num_bits > 0, "Bloom filter needs at least one bit.");
+        static_assert(num_hash_functions > 0, "Bloom filter needs at least one hash function.");
+
+        /**
+         * Constructor. Derives the salt values of all hash functions from the
+         * default seed.
+         */
+        sized_bloom_filter()
+        :   base_t(num_bits, num_hash_functions)
+        {
+            // ctor
         };
 
-    private:
         /**
-         * The array of hash functions. All hash functions ideally should have
-         * different salt values. This is currently not enforced.
+         * Constructor. Derives the salt values of all hash functions from a
+         * seed.
+         *
+         * \param seed  Seed of the salt values
          */
-        std::array<detail::hash_fn<hash_precision, T>, num_hash_functions>
-            m_hash_functions;
+        explicit sized_bloom_filter(filter_seed const seed)
+        :   base_t(num_bits, num_hash_functions, seed)
+        {
+            // ctor
+        };
 
         /**
-         * The bitset of hash function hits. The result space of the hash
-         * functions is a bitset of size <code>hash_precision</code>, so the
-         * bitset of hits has a size of $2^{hash_precision}$ to have an entry
-         * for each possible return value.
+         * Destructor.
          */
-        std::bitset<(1ul<<hash_precision)> m_hash_hits;
-};
+        ~sized_bloom_filter() = default;
+
+        /**
+         * Read a filter written by <code>save</code> from a stream. The
+         * filter must have been saved with the same parameters.
+         *
+         * \param in    Stream to read from
+         * \return      The filter
+         * \throw std::runtime_error if the stream does not hold a matching
+         *              filter
+         */
+        static sized_bloom_filter load(std::istream& in)
+        {
+            return sized_bloom_filter(base_t::load(in));
+        };
 
+    private:
+        using base_t = dynamic_bloom_filter<T, hashing, hasher, instrumentation>;
+
+        /**
+         * Constructor. Takes over a loaded filter after checking its
+         * parameters.
+         *
+         * \param filter    Loaded filter
+         */
+        explicit sized_bloom_filter(base_t&& filter)
+        :   base_t(std::move(filter))
+        {
+            if (this->num_bits() != num_bits or this->num_hash_functions() != num_hash_functions)
+                throw std::runtime_error("filter was saved with different parameters");
+        };
+};
@@ -0,0 +1,116 @@
+#include <cstdint>
+#include <stdexcept>
+
+#include "atomic_bit_array.hpp"
+#include "index_generator.hpp"
+
+#pragma once
+
+/**
+ * Bloom filter that any number of threads can add to and test concurrently,
+ * without locks. It behaves like a <code>dynamic_bloom_filter</code> with the
+ * same parameters, but its bits are <code>std::atomic</code> words that are
+ * set with a relaxed <code>fetch_or</code>.
+ *
+ * Guarantees: a value whose <code>add</code> has returned in some thread is
+ * reported by <code>test</code> in any thread that synchronized with it
+ * afterwards (e.g. through a join, a mutex or a release/acquire pair). A
+ * <code>test</code> concurrent with the <code>add</code> of the same value
+ * may return either result. Words are never read torn, so concurrent use can
+ * not produce results other than these.
+ *
+ * \param T         Template parameter for the type to build the filter for.
+ * \param hashing   Hashing scheme, <code>independent_hashing</code> or
+ *                  <code>double_hashing</code>.
+ * \param hasher    Hasher, e.g. <code>wyhash_hasher</code> or
+ *                  <code>std_hasher</code>.
+ */
+template<typename T, typename hashing = independent_hashing,
+    typename hasher = wyhash_hasher>
+class concurrent_bloom_filter
+{
+    public:
+        /**
+         * Constructor. Derives the salt values of all hash functions from the
+         * default seed.
+         *
+         * \param num_bits              Number of bits in the filter
+         * \param num_hash_functions    Number of hash functions to use
+         * \param huge_pages            Whether to try to back the bits with
+         *                              huge pages
+         */
+        concurrent_bloom_filter(size_t const num_bits,
+                size_t const num_hash_functions,
+                bool const huge_pages = false)
+        :   m_indices(num_hash_functions),
+            m_hash_hits(num_bits, huge_pages)
+        {
+            if (num_bits == 0)
+                throw std::invalid_argument("bloom filter needs at least one bit");
+            if (num_hash_functions == 0)
+                throw std::invalid_argument("bloom filter needs at least one hash function");
+        };
+
+        /**
+         * Destructor.
+         */
+        ~concurrent_bloom_filter() = default;
+
+        /**
+         * Add a value to the filter. Safe to call from several threads at
+         * once, and concurrently with <code>test</code>.
+         *
+         * \param t     Value to add
+         */
+        void add(T const& t)
+        {
+            auto const hashed = m_indices.hash(t);
+            for (size_t i = 0; i < m_indices.size(); ++i)
+            {
+                m_hash_hits.set(hashed.index(i, m_hash_hits.size()));
+            }
+        };
+
+        /**
+         * Test whether a value is in the filter. The return value
+         * <code>false</code> means that the value is <i>guaranteed</i> not to
+         * be in the filter. The return value <code>true</code> means that the
+         * value <i>maybe</i> is in the set. Safe to call from several threads
+         * at once, and concurrently with <code>add</code>.
+         *
+         * \param t     Data item to check for
+         * \return      Boolean value indicating membership
+         */
+        bool test(T const& t) const
+        {
+            auto const hashed = m_indices.hash(t);
+            for (size_t i = 0; i < m_indices.size(); ++i)
+            {
+                if (not m_hash_hits.test(hashed.index(i, m_hash_hits.size())))
+                    return false;
+            }
+            return true;
+        };
+
+        /**
+         * \return      Number of bits in the filter
+         */
+        size_t num_bits() const { return m_hash_hits.size(); }
+
+        /**
+         * \return      Number of hash functions used per value
+         */
+        size_t num_hash_functions() const { return m_indices.size(); }
+
+    private:
+        /**
+         * Computes the indices of a value, one per hash function. Only read
+         * after construction, so it can be shared between threads.
+         */
+        detail::index_generator<T, hashing, hasher> m_indices;
+
+        /**
+         * The bits set by hash function hits.
+         */
+        detail::atomic_bit_array m_hash_hits;
+};
@@ -0,0 +1,149 @@
+#include <cstdint>
+
+#include "bit_array.hpp"
+
+#pragma once
+
+namespace detail
+{
+    /**
+     * Heap-allocated array of 4-bit saturating counters, packed 16 to a
+     * 64-bit word. The storage is a <code>bit_array</code> of four bits per
+     * counter, so it is cache-line-aligned and can be backed by huge pages.
+     *
+     * A counter that reaches the maximum sticks there: its true count is no
+     * longer known, so decrementing it would risk dropping to zero while
+     * values still map to it.
+     */
+    class counter_array
+    {
+        public:
+            using word_t = bit_array::word_t;
+
+            /**
+             * Number of bits per counter.
+             */
+            static constexpr size_t const counter_bits = 4;
+
+            /**
+             * Number of counters in one storage word.
+             */
+            static constexpr size_t const counters_per_word = bit_array::word_bits / counter_bits;
+
+            /**
+             * Largest value of a counter, at which it saturates.
+             */
+            static constexpr word_t const max_count = (word_t{1} << counter_bits) - 1;
+
+            /**
+             * Constructor. All counters are initially zero.
+             *
+             * \param num_counters  Number of counters to store
+             * \param huge_pages    Whether to try to back the storage with
+             *                      huge pages
+             */
+            explicit counter_array(size_t const num_counters, bool const huge_pages = false)
+            :   m_bits(num_counters * counter_bits, huge_pages),
+                m_num_counters(num_counters)
+            {
+                // ctor
+            }
+
+            /**
+             * Increment a counter, unless it is saturated.
+             *
+             * \param idx   Index of the counter
+             */
+            void increment(size_t const idx)
+            {
+                word_t& word = m_bits.data()[idx / counters_per_word];
+                size_t const shift = (idx % counters_per_word) * counter_bits;
+                if (((word >> shift) & max_count) != max_count)
+                    word += word_t{1} << shift;
+            }
+
+            /**
+             * Decrement a counter, unless it is zero or saturated.
+             *
+             * \param idx   Index of the counter
+             */
+            void decrement(size_t const idx)
+            {
+                word_t& word = m_bits.data()[idx / counters_per_word];
+                size_t const shift = (idx % counters_per_word) * counter_bits;
+                word_t const count = (word >> shift) & max_count;
+                if (count != 0 and count != max_count)
+                    word -= word_t{1} << shift;
+            }
+
+            /**
+             * \param idx   Index of the counter
+             * \return      Value of the counter
+             */
+            word_t count(size_t const idx) const
+            {
+                size_t const shift = (idx % counters_per_word) * counter_bits;
+                return (m_bits.data()[idx / counters_per_word] >> shift) & max_count;
+            }
+
+            /**
+             * Test a counter for zero.
+             *
+             * \param idx   Index of the counter
+             * \return      Whether the counter is not zero
+             */
+            bool test(size_t const idx) const
+            {
+                return count(idx) != 0;
+            }
+
+            /**
+             * Prefetch the word holding a counter, to be read.
+             *
+             * \param idx   Index of the counter
+             */
+            void prefetch_read(size_t const idx) const
+            {
+                m_bits.prefetch_read(idx * counter_bits);
+            }
+
+            /**
+             * Prefetch the word holding a counter, to be written.
+             *
+             * \param idx   Index of the counter
+             */
+            void prefetch_write(size_t const idx) const
+            {
+                m_bits.prefetch_write(idx * counter_bits);
+            }
+
+            /**
+             * Set all counters to zero.
+             */
+            void reset()
+            {
+                m_bits.reset();
+            }
+
+            /**
+             * \return      Number of counters stored
+             */
+            size_t size() const { return m_num_counters; }
+
+            /**
+             * \return      Number of storage words
+             */
+            size_t num_words() const { return m_bits.num_words(); }
+
+        private:
+            /**
+             * The counters, four bits each.
+             */
+            bit_array m_bits;
+
+            /**
+             * Number of counters stored.
+             */
+            size_t m_num_counters;
+    }; // class counter_array
+} // namespace detail
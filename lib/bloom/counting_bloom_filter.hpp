@@ -0,0 +1,153 @@
+#include <cstdint>
+#include <stdexcept>
+
+#include "counter_array.hpp"
+#include "index_generator.hpp"
+
+#pragma once
+
+/**
+ * Bloom filter that supports removing values. Instead of one bit, every slot
+ * holds a 4-bit counter of the values mapping to it, so the filter needs four
+ * times the memory of a <code>dynamic_bloom_filter</code> with the same
+ * number of slots and the same false positive rate.
+ *
+ * Counters saturate at 15 and then never decrease again. With optimal
+ * parameters the chance of any counter reaching 15 is negligible (about
+ * 1.4e-15 per counter, Fan et al., "Summary Cache"), but heavily overloaded
+ * filters keep some slots set after their values were removed.
+ *
+ * Only values that were added may be removed. Removing any other value
+ * decrements counters of other values and can make them test negative.
+ *
+ * \param T         Template parameter for the type to build the filter for.
+ * \param hashing   Hashing scheme, <code>independent_hashing</code> or
+ *                  <code>double_hashing</code>.
+ * \param hasher    Hasher, e.g. <code>wyhash_hasher</code> or
+ *                  <code>std_hasher</code>.
+ */
+template<typename T, typename hashing = independent_hashing,
+    typename hasher = wyhash_hasher>
+class counting_bloom_filter
+{
+    public:
+        /**
+         * Constructor. Derives the salt values of all hash functions from the
+         * default seed.
+         *
+         * \param num_counters          Number of counters in the filter, the
+         *                              equivalent of the number of bits of a
+         *                              <code>dynamic_bloom_filter</code>
+         * \param num_hash_functions    Number of hash functions to use
+         * \param huge_pages            Whether to try to back the counters
+         *                              with huge pages
+         */
+        counting_bloom_filter(size_t const num_counters,
+                size_t const num_hash_functions,
+                bool const huge_pages = false)
+        :   m_indices(num_hash_functions),
+            m_counters(num_counters, huge_pages)
+        {
+            if (num_counters == 0)
+                throw std::invalid_argument("bloom filter needs at least one counter");
+            if (num_hash_functions == 0)
+                throw std::invalid_argument("bloom filter needs at least one hash function");
+        };
+
+        /**
+         * Destructor.
+         */
+        ~counting_bloom_filter() = default;
+
+        /**
+         * Add a value to the filter. This increments the counters at all
+         * indices of the value.
+         *
+         * \param t     Value to add
+         */
+        void add(T const& t)
+        {
+            auto const hashed = m_indices.hash(t);
+            for (size_t i = 0; i < m_indices.size(); ++i)
+            {
+                m_counters.increment(hashed.index(i, m_counters.size()));
+            }
+        };
+
+        /**
+         * Remove a value that was added before. This decrements the counters
+         * at all indices of the value. A value that tests negative is
+         * certainly not in the filter and is left alone.
+         *
+         * \param t     Value to remove
+         * \return      Whether the value was found and removed
+         */
+        bool remove(T const& t)
+        {
+            // compute every index once, as independent hashing hashes the
+            // value again for each of them
+            size_t const k = m_indices.size();
+            detail::index_buffer<16> indices (k);
+            auto const hashed = m_indices.hash(t);
+            for (size_t i = 0; i < k; ++i)
+            {
+                indices[i] = hashed.index(i, m_counters.size());
+                if (not m_counters.test(indices[i]))
+                    return false;
+            }
+            for (size_t i = 0; i < k; ++i)
+            {
+                m_counters.decrement(indices[i]);
+            }
+            return true;
+        };
+
+        /**
+         * Test whether a value is in the filter. The return value
+         * <code>false</code> means that the value is <i>guaranteed</i> not to
+         * be in the filter. The return value <code>true</code> means that the
+         * value <i>maybe</i> is in the set.
+         *
+         * \param t     Data item to check for
+         * \return      Boolean value indicating membership
+         */
+        bool test(T const& t) const
+        {
+            auto const hashed = m_indices.hash(t);
+            for (size_t i = 0; i < m_indices.size(); ++i)
+            {
+                if (not m_counters.test(hashed.index(i, m_counters.size())))
+                    return false;
+            }
+            return true;
+        };
+
+        /**
+         * Remove all values.
+         */
+        void clear()
+        {
+            m_counters.reset();
+        };
+
+        /**
+         * \return      Number of counters in the filter
+         */
+        size_t num_counters() const { return m_counters.size(); }
+
+        /**
+         * \return      Number of hash functions used per value
+         */
+        size_t num_hash_functions() const { return m_indices.size(); }
+
+    private:
+        /**
+         * Computes the indices of a value, one per hash function.
+         */
+        detail::index_generator<T, hashing, hasher> m_indices;
+
+        /**
+         * The counters incremented by hash function hits.
+         */
+        detail::counter_array m_counters;
+};
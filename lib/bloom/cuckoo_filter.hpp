@@ -0,0 +1,435 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "bit_array.hpp"
+#include "hash_fn.hpp"
+#include "hashers.hpp"
+
+#pragma once
+
+/**
+ * Cuckoo filter (Fan et al., "Cuckoo Filter: Practically Better Than
+ * Bloom"). Instead of setting bits, it stores a small fingerprint of every
+ * value in one of two candidate buckets of 4 slots. A test compares the
+ * fingerprint with the 8 slots of the two buckets, so it touches at most two
+ * cache lines regardless of the false positive rate. Values can be removed.
+ *
+ * The false positive rate is about <code>8 / 2^fingerprint_bits</code>:
+ *  - 8 bit fingerprints: 3%
+ *  - 12 bit fingerprints: 0.2%
+ *  - 16 bit fingerprints: 0.012%
+ * at a memory cost of about <code>fingerprint_bits / 0.95</code> bits per
+ * value, 13.5 with 12 bit fingerprints (see below). A bloom filter with the
+ * same rate needs about <code>1.44 log2(1 / rate)</code> bits per value, so
+ * the cuckoo filter only saves memory below a rate of about 0.2%: with 8
+ * bit fingerprints it needs about 15% more than a bloom filter, with 12 bit
+ * ones about as much, and with 16 bit ones about 10% less.
+ *
+ * Buckets are packed into cache lines and never straddle two of them. With
+ * 12 bit fingerprints 10 buckets share a line, leaving 32 bits unused.
+ *
+ * Unlike a bloom filter, a cuckoo filter can be full: <code>add</code> moves
+ * fingerprints between their two buckets to make room, and gives up after
+ * <code>max_kicks</code> moves, leaving the filter as it was. The filter is
+ * sized so that the requested capacity fits with high probability.
+ *
+ * \param T                 Template parameter for the type to build the
+ *                          filter for. As for <code>bloom_filter</code>, user
+ *                          types need a <code>std::hash</code>
+ *                          specialization.
+ * \param fingerprint_bits  Bits per fingerprint, 8, 12 or 16.
+ * \param hasher            Hasher, e.g. <code>wyhash_hasher</code> or
+ *                          <code>std_hasher</code>.
+ */
+template<typename T, size_t fingerprint_bits = 12, typename hasher = wyhash_hasher>
+class cuckoo_filter
+{
+    public:
+        static_assert(fingerprint_bits == 8 or fingerprint_bits == 12 or fingerprint_bits == 16,
+                "Fingerprints must have 8, 12 or 16 bits.");
+
+        using bucket_t = std::uint64_t;
+
+        /**
+         * Number of slots per bucket.
+         */
+        static constexpr size_t const bucket_slots = 4;
+
+        /**
+         * Number of bytes per bucket.
+         */
+        static constexpr size_t const bucket_bytes = bucket_slots * fingerprint_bits / 8;
+
+        /**
+         * Number of buckets per cache line.
+         */
+        static constexpr size_t const buckets_per_line = detail::cache_line_size / bucket_bytes;
+
+        /**
+         * Number of fingerprints moved by <code>add</code> before it gives
+         * up.
+         */
+        static constexpr size_t const max_kicks = 500;
+
+        /**
+         * Fraction of the slots that can be filled with high probability.
+         */
+        static constexpr double const max_load_factor = 0.95;
+
+        /**
+         * Constructor. Derives the salt value of the hash function from the
+         * default seed.
+         *
+         * \param capacity      Number of values the filter should hold
+         * \param huge_pages    Whether to try to back the buckets with huge
+         *                      pages
+         */
+        explicit cuckoo_filter(size_t const capacity, bool const huge_pages = false)
+        :   m_num_buckets(num_buckets_for(capacity)),
+            m_hash_function(),
+            m_buckets(bits_for(m_num_buckets), huge_pages),
+            m_random(0),
+            m_size(0)
+        {
+            if (capacity == 0)
+                throw std::invalid_argument("cuckoo filter needs a capacity");
+
+            std::uint64_t seed = detail::default_seed;
+            m_hash_function = detail::hash_fn<T, hasher>(detail::splitmix64(seed));
+            m_random = seed;
+        };
+
+        /**
+         * Destructor.
+         */
+        ~cuckoo_filter() = default;
+
+        /**
+         * Add a value to the filter.
+         *
+         * If the two buckets of the value are full, fingerprints are moved to
+         * their other bucket to make room. If that fails after
+         * <code>max_kicks</code> moves, the filter is full around the value:
+         * all moves are undone and the value is not added. All values added
+         * before stay in the filter, and later calls may still add values
+         * whose buckets have room, or this one after a removal.
+         *
+         * \param t     Value to add
+         * \return      Whether the value was added; <code>false</code>
+         *              means the filter is unchanged
+         */
+        bool add(T const& t)
+        {
+            auto const [fp, b1] = locate(t);
+            size_t const b2 = alternate(b1, fp);
+            if (insert(b1, fp) or insert(b2, fp) or kick(b1, b2, fp))
+            {
+                ++m_size;
+                return true;
+            }
+            return false;
+        };
+
+        /**
+         * Test whether a value is in the filter. The return value
+         * <code>false</code> means that the value is <i>guaranteed</i> not to
+         * be in the filter. The return value <code>true</code> means that the
+         * value <i>maybe</i> is in the set.
+         *
+         * \param t     Data item to check for
+         * \return      Boolean value indicating membership
+         */
+        bool test(T const& t) const
+        {
+            auto const [fp, b1] = locate(t);
+            size_t const b2 = alternate(b1, fp);
+            return contains(load(b1), fp) or contains(load(b2), fp);
+        };
+
+        /**
+         * Remove a value that was added before. Removing a value that was
+         * not added can remove another value with the same fingerprint and
+         * buckets, which then tests negative.
+         *
+         * \param t     Value to remove
+         * \return      Whether a fingerprint of the value was found and
+         *              removed
+         */
+        bool remove(T const& t)
+        {
+            auto const [fp, b1] = locate(t);
+            size_t const b2 = alternate(b1, fp);
+            if (erase(b1, fp) or erase(b2, fp))
+            {
+                --m_size;
+                return true;
+            }
+            return false;
+        };
+
+        /**
+         * \return      Number of values in the filter
+         */
+        size_t size() const { return m_size; }
+
+        /**
+         * \return      Number of buckets
+         */
+        size_t num_buckets() const { return m_num_buckets; }
+
+        /**
+         * \return      Number of bits of memory used by the buckets
+         */
+        size_t num_bits() const { return m_buckets.size(); }
+
+        /**
+         * \return      Fraction of the slots in use
+         */
+        double load_factor() const
+        {
+            return static_cast<double>(m_size) / (m_num_buckets * bucket_slots);
+        }
+
+    private:
+        /**
+         * Mask of the bits of one fingerprint.
+         */
+        static constexpr bucket_t const fingerprint_mask = (bucket_t{1} << fingerprint_bits) - 1;
+
+        /**
+         * \param capacity  Number of values
+         * \return          Number of buckets to hold them
+         */
+        static size_t num_buckets_for(size_t const capacity)
+        {
+            double const buckets = capacity / (bucket_slots * max_load_factor);
+            return std::max<size_t>(1, static_cast<size_t>(buckets) + 1);
+        }
+
+        /**
+         * \param num_buckets   Number of buckets
+         * \return              Number of bits of whole cache lines holding
+         *                      them
+         */
+        static size_t bits_for(size_t const num_buckets)
+        {
+            size_t const lines = (num_buckets + buckets_per_line - 1) / buckets_per_line;
+            return lines * detail::cache_line_size * 8;
+        }
+
+        /**
+         * Hash a value to its fingerprint, which is never zero since zero
+         * marks empty slots, and its first bucket.
+         *
+         * \param t     Value
+         * \return      Fingerprint and first bucket
+         */
+        std::pair<bucket_t, size_t> locate(T const& t) const
+        {
+            auto const hash = m_hash_function.hash(t);
+            bucket_t fp = hash & fingerprint_mask;
+            if (fp == 0) fp = 1;
+            return { fp, detail::fast_range(hash, m_num_buckets) };
+        }
+
+        /**
+         * The other bucket of a fingerprint. The mapping
+         *      b -> (h(fp) - b) mod num_buckets
+         * is its own inverse, so it leads back from either bucket to the
+         * other, for any number of buckets.
+         *
+         * \param b     One bucket of the fingerprint
+         * \param fp    Fingerprint
+         * \return      The other bucket of the fingerprint
+         */
+        size_t alternate(size_t const b, bucket_t const fp) const
+        {
+            size_t const h = detail::fast_range(fp * detail::multiply_shift_constant, m_num_buckets);
+            return h >= b ? h - b : h + m_num_buckets - b;
+        }
+
+        /**
+         * \param b     Bucket
+         * \return      Offset of the first byte of the bucket
+         */
+        static size_t offset(size_t const b)
+        {
+            return (b / buckets_per_line) * detail::cache_line_size
+                + (b % buckets_per_line) * bucket_bytes;
+        }
+
+        /**
+         * \param b     Bucket
+         * \return      The slots of the bucket, in the low bits of a word
+         */
+        bucket_t load(size_t const b) const
+        {
+            bucket_t bucket = 0;
+            std::memcpy(&bucket, reinterpret_cast<unsigned char const*>(m_buckets.data()) + offset(b),
+                    bucket_bytes);
+            return bucket;
+        }
+
+        /**
+         * \param b         Bucket
+         * \param bucket    New slots of the bucket
+         */
+        void store(size_t const b, bucket_t const bucket)
+        {
+            std::memcpy(reinterpret_cast<unsigned char*>(m_buckets.data()) + offset(b), &bucket,
+                    bucket_bytes);
+        }
+
+        /**
+         * \return      Fingerprint in a slot of a bucket, zero if empty
+         */
+        static bucket_t get(bucket_t const bucket, size_t const slot)
+        {
+            return (bucket >> (slot * fingerprint_bits)) & fingerprint_mask;
+        }
+
+        /**
+         * Overwrite a slot of a bucket.
+         */
+        static void set(bucket_t& bucket, size_t const slot, bucket_t const fp)
+        {
+            bucket &= ~(fingerprint_mask << (slot * fingerprint_bits));
+            bucket |= fp << (slot * fingerprint_bits);
+        }
+
+        /**
+         * \return      Whether a bucket holds a fingerprint
+         */
+        static bool contains(bucket_t const bucket, bucket_t const fp)
+        {
+            for (size_t slot = 0; slot < bucket_slots; ++slot)
+            {
+                if (get(bucket, slot) == fp) return true;
+            }
+            return false;
+        }
+
+        /**
+         * Put a fingerprint in an empty slot of a bucket.
+         *
+         * \return      Whether the bucket had an empty slot
+         */
+        bool insert(size_t const b, bucket_t const fp)
+        {
+            bucket_t bucket = load(b);
+            for (size_t slot = 0; slot < bucket_slots; ++slot)
+            {
+                if (get(bucket, slot) == 0)
+                {
+                    set(bucket, slot, fp);
+                    store(b, bucket);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * Remove one copy of a fingerprint from a bucket.
+         *
+         * \return      Whether the bucket held the fingerprint
+         */
+        bool erase(size_t const b, bucket_t const fp)
+        {
+            bucket_t bucket = load(b);
+            for (size_t slot = 0; slot < bucket_slots; ++slot)
+            {
+                if (get(bucket, slot) == fp)
+                {
+                    set(bucket, slot, 0);
+                    store(b, bucket);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * Make room for a fingerprint whose buckets are both full: kick a
+         * random fingerprint to its other bucket, and repeat with that one
+         * until one finds an empty slot. If none does within
+         * <code>max_kicks</code> moves, the moves are undone in reverse
+         * order, which puts every kicked fingerprint back.
+         *
+         * \param b1    First bucket of the fingerprint
+         * \param b2    Second bucket of the fingerprint
+         * \param fp    Fingerprint
+         * \return      Whether the fingerprint was placed
+         */
+        bool kick(size_t const b1, size_t const b2, bucket_t const fp)
+        {
+            std::array<std::pair<size_t, size_t>, max_kicks> moves;
+            size_t b = (detail::splitmix64(m_random) & 1) ? b1 : b2;
+            bucket_t f = fp;
+            for (size_t i = 0; i < max_kicks; ++i)
+            {
+                size_t const slot = detail::splitmix64(m_random) % bucket_slots;
+                f = swap(b, slot, f);
+                moves[i] = { b, slot };
+
+                b = alternate(b, f);
+                if (insert(b, f)) return true;
+            }
+
+            // f is the fingerprint left over; swapping it back along the
+            // moves ends with fp, which stays out
+            for (size_t i = max_kicks; i-- > 0; )
+            {
+                f = swap(moves[i].first, moves[i].second, f);
+            }
+            return false;
+        }
+
+        /**
+         * Replace the fingerprint in a slot of a bucket.
+         *
+         * \param b     Bucket
+         * \param slot  Slot of the bucket
+         * \param fp    New fingerprint of the slot
+         * \return      Fingerprint that was in the slot
+         */
+        bucket_t swap(size_t const b, size_t const slot, bucket_t const fp)
+        {
+            bucket_t bucket = load(b);
+            bucket_t const old = get(bucket, slot);
+            set(bucket, slot, fp);
+            store(b, bucket);
+            return old;
+        }
+
+        /**
+         * Number of buckets.
+         */
+        size_t m_num_buckets;
+
+        /**
+         * Hash function yielding the fingerprint and first bucket.
+         */
+        detail::hash_fn<T, hasher> m_hash_function;
+
+        /**
+         * The buckets, packed into cache lines.
+         */
+        detail::bit_array m_buckets;
+
+        /**
+         * State of the SplitMix64 generator choosing the fingerprints to
+         * move. It continues the sequence of the salt, so a filter makes the
+         * same moves with every standard library.
+         */
+        std::uint64_t m_random;
+
+        /**
+         * Number of values in the filter.
+         */
+        size_t m_size;
+};
@@ -0,0 +1,728 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "bit_array.hpp"
+#include "index_generator.hpp"
+#include "instrumentation.hpp"
+#include "parallel_build.hpp"
+#include "parameters.hpp"
+#include "serialization.hpp"
+
+#pragma once
+
+template<typename T, typename hashing, typename hasher>
+class mapped_bloom_filter;
+
+/**
+ * Bloom filter whose size and number of hash functions are chosen at
+ * runtime. See <code>bloom_filter</code> for a description of the data
+ * structure and how to choose its parameters.
+ *
+ * Unlike <code>bloom_filter</code>, the number of bits does not have to be a
+ * power of two, so the filter can be sized exactly for an expected number of
+ * elements. The bits live in a cache-line-aligned heap allocation, which can
+ * optionally be backed by huge pages to reduce TLB misses on large filters.
+ *
+ * Thread safety: all const member functions only read the filter, so once it
+ * is built any number of threads may test it concurrently through a
+ * <code>const</code> reference, without locks. Adding values must not run
+ * concurrently with anything else; use <code>concurrent_bloom_filter</code>
+ * for concurrent inserts.
+ *
+ * A filter can be written to a stream with <code>save</code> and read back
+ * with <code>load</code>, or queried in place from a file with
+ * <code>mapped_bloom_filter</code>. The hash functions are restored from
+ * their saved salt values, so the filter answers exactly as before.
+ *
+ * Filters of byte strings, e.g. <code>std::string</code>, whose hasher is
+ * transparent (both hashers of this library are) also add and test
+ * <code>std::string_view</code>s, character pointers and raw byte ranges
+ * directly, without building a temporary <code>std::string</code>.
+ *
+ * \param T         Template parameter for the type to build the filter for.
+ * \param hashing   Hashing scheme, <code>independent_hashing</code> or
+ *                  <code>double_hashing</code>.
+ * \param hasher    Hasher, e.g. <code>wyhash_hasher</code> or
+ *                  <code>std_hasher</code>.
+ * \param instrumentation   Instrumentation policy. The default
+ *                  <code>no_instrumentation</code> compiles away;
+ *                  <code>counting_instrumentation</code> counts adds,
+ *                  tests and positive tests and times batch calls, see
+ *                  <code>statistics</code>.
+ */
+template<typename T, typename hashing = independent_hashing,
+    typename hasher = wyhash_hasher, typename instrumentation = no_instrumentation>
+class dynamic_bloom_filter : private instrumentation
+{
+    template<typename, typename, typename>
+    friend class mapped_bloom_filter;
+
+        /**
+         * Whether <code>add_batch</code> and <code>test_batch</code> accept
+         * an array of <code>K</code>.
+         */
+        template<typename K>
+        static constexpr bool const batch_key = std::is_same_v<K, T>
+            or detail::is_transparent_key_v<T, K, hasher>;
+
+        /**
+         * Whether <code>add</code> and <code>test</code> accept byte ranges,
+         * i.e. <code>U</code> is a byte string and the hasher is
+         * transparent.
+         */
+        template<typename U>
+        static constexpr bool const accepts_bytes = std::is_same_v<U, std::string_view>
+            or detail::is_transparent_key_v<U, std::string_view, hasher>;
+
+    public:
+        /**
+         * Number of values hashed ahead in <code>add_batch</code> and
+         * <code>test_batch</code>. The memory accesses of all their indices
+         * are in flight at the same time.
+         */
+        static constexpr size_t const batch_window = 8;
+
+        /**
+         * Constructor. Derives the salt values of all hash functions from the
+         * default seed.
+         *
+         * \param num_bits              Number of bits in the filter
+         * \param num_hash_functions    Number of hash functions to use
+         * \param huge_pages            Whether to try to back the bits with
+         *                              huge pages
+         */
+        dynamic_bloom_filter(size_t const num_bits,
+                size_t const num_hash_functions,
+                bool const huge_pages = false)
+        :   dynamic_bloom_filter(num_bits, num_hash_functions,
+                    filter_seed{detail::default_seed}, huge_pages)
+        {
+            // ctor
+        };
+
+        /**
+         * Constructor. Derives the salt values of all hash functions from a
+         * seed, so that filters built elsewhere with the same seed and
+         * parameters are compatible with this one.
+         *
+         * \param num_bits              Number of bits in the filter
+         * \param num_hash_functions    Number of hash functions to use
+         * \param seed                  Seed of the salt values
+         * \param huge_pages            Whether to try to back the bits with
+         *                              huge pages
+         */
+        dynamic_bloom_filter(size_t const num_bits,
+                size_t const num_hash_functions,
+                filter_seed const seed,
+                bool const huge_pages = false)
+        :   m_indices(num_hash_functions, seed.value),
+            m_hash_hits(num_bits, huge_pages)
+        {
+            if (num_bits == 0)
+                throw std::invalid_argument("bloom filter needs at least one bit");
+            if (num_hash_functions == 0)
+                throw std::invalid_argument("bloom filter needs at least one hash function");
+        };
+
+        /**
+         * Constructor. Sizes the filter with parameters computed by e.g.
+         * <code>optimal_parameters</code>.
+         *
+         * \param parameters    Number of bits and hash functions
+         * \param huge_pages    Whether to try to back the bits with huge
+         *                      pages
+         */
+        explicit dynamic_bloom_filter(bloom_parameters const& parameters,
+                bool const huge_pages = false)
+        :   dynamic_bloom_filter(parameters.num_bits, parameters.num_hash_functions, huge_pages)
+        {
+            // ctor
+        };
+
+        /**
+         * Constructor. Sizes the filter with parameters computed by e.g.
+         * <code>optimal_parameters</code> and derives the salt values from
+         * a seed.
+         *
+         * \param parameters    Number of bits and hash functions
+         * \param seed          Seed of the salt values
+         * \param huge_pages    Whether to try to back the bits with huge
+         *                      pages
+         */
+        dynamic_bloom_filter(bloom_parameters const& parameters, filter_seed const seed,
+                bool const huge_pages = false)
+        :   dynamic_bloom_filter(parameters.num_bits, parameters.num_hash_functions,
+                    seed, huge_pages)
+        {
+            // ctor
+        };
+
+        dynamic_bloom_filter(dynamic_bloom_filter const&) = default;
+        dynamic_bloom_filter(dynamic_bloom_filter&&) = default;
+        dynamic_bloom_filter& operator= (dynamic_bloom_filter const&) = default;
+        dynamic_bloom_filter& operator= (dynamic_bloom_filter&&) = default;
+
+        /**
+         * Destructor.
+         */
+        ~dynamic_bloom_filter() = default;
+
+        /**
+         * Add a value to the filter. This hashes the value with all hash
+         * functions and sets the respective bits in the bit array.
+         *
+         * \param t     Value to add
+         */
+        void add(T const& t)
+        {
+            add_key(t);
+        };
+
+        /**
+         * Add a key of another type, which the hasher hashes exactly like
+         * the equal value, e.g. a <code>std::string_view</code> to a filter
+         * of <code>std::string</code>. The key is not converted.
+         *
+         * \param key   Key to add
+         */
+        template<typename K,
+            std::enable_if_t<detail::is_transparent_key_v<T, K, hasher>, int> = 0>
+        void add(K const& key)
+        {
+            add_key(key);
+        };
+
+        /**
+         * Add a byte string given as a pointer and size to a filter of byte
+         * strings. Same as adding the equal <code>std::string_view</code>.
+         *
+         * \param data  Pointer to the first byte
+         * \param size  Number of bytes
+         */
+        template<typename U = T,
+            std::enable_if_t<accepts_bytes<U>, int> = 0>
+        void add(void const* data, size_t const size)
+        {
+            add(std::string_view(static_cast<char const*>(data), size));
+        };
+
+        /**
+         * Test whether a value is in the filter. The return value
+         * <code>false</code> means that the value is <i>guaranteed</i> not to
+         * be in the filter. The return value <code>true</code> means that the
+         * value <i>maybe</i> is in the set.
+         *
+         * \param t     Data item to check for
+         * \return      Boolean value indicating membership
+         */
+        bool test(T const& t) const
+        {
+            return test_key(t);
+        };
+
+        /**
+         * Test whether a key of another type is in the filter, see the
+         * respective <code>add</code>.
+         *
+         * \param key   Key to check for
+         * \return      Boolean value indicating membership
+         */
+        template<typename K,
+            std::enable_if_t<detail::is_transparent_key_v<T, K, hasher>, int> = 0>
+        bool test(K const& key) const
+        {
+            return test_key(key);
+        };
+
+        /**
+         * Test whether a byte string given as a pointer and size is in a
+         * filter of byte strings.
+         *
+         * \param data  Pointer to the first byte
+         * \param size  Number of bytes
+         * \return      Boolean value indicating membership
+         */
+        template<typename U = T,
+            std::enable_if_t<accepts_bytes<U>, int> = 0>
+        bool test(void const* data, size_t const size) const
+        {
+            return test(std::string_view(static_cast<char const*>(data), size));
+        };
+
+        /**
+         * Add several values to the filter. This has the same effect as
+         * calling <code>add</code> for every value, but hashes
+         * <code>batch_window</code> values ahead and prefetches all the words
+         * they touch, so that the cache misses overlap.
+         *
+         * \param values    Pointer to the first value, of type
+         *                  <code>T</code> or of a key type accepted by
+         *                  <code>add</code>
+         * \param count     Number of values
+         */
+        template<typename K,
+            std::enable_if_t<batch_key<K>, int> = 0>
+        void add_batch(K const* values, size_t const count)
+        {
+            auto const start = instruments().batch_start();
+            window_buffer indices (batch_window * m_indices.size());
+            for (size_t first = 0; first < count; first += batch_window)
+            {
+                size_t const n = std::min(batch_window, count - first);
+                hash_window(values + first, n, indices.data(), true);
+                for (size_t j = 0; j < n * m_indices.size(); ++j)
+                {
+                    m_hash_hits.set(indices[j]);
+                }
+            }
+            instruments().added(count);
+            instruments().batch_end(start);
+        };
+
+        /**
+         * Add all values of a range, hashing them on several threads. This
+         * has the same effect as calling <code>add</code> for every value.
+         * The bit array is split among the threads and each one only writes
+         * its own part, so no copies of the filter are made; the extra
+         * memory is about <code>num_hash_functions</code> 128 KiB buffers
+         * per thread.
+         *
+         * Do not call other members of the filter while this runs.
+         *
+         * \param first         Iterator to the first value
+         * \param last          Iterator past the last value
+         * \param num_threads   Number of threads to use, including the
+         *                      calling one; 0 for all hardware threads
+         */
+        template<typename iterator_t>
+        void build(iterator_t first, iterator_t const last, size_t num_threads = 0)
+        {
+            if (num_threads == 0) num_threads = detail::default_num_threads();
+            auto const start = instruments().batch_start();
+            if (num_threads == 1)
+            {
+                for (; first != last; ++first) add_key(*first);
+                instruments().batch_end(start);
+                return;
+            }
+
+            if constexpr (instrumentation::enabled)
+                instruments().added(static_cast<size_t>(std::distance(first, last)));
+            size_t const range = m_hash_hits.size();
+            detail::parallel_build(first, last, num_threads, m_hash_hits,
+                    [this, range](auto const& value, size_t* out)
+                    {
+                        auto const hashed = m_indices.hash(value);
+                        for (size_t i = 0; i < m_indices.size(); ++i)
+                        {
+                            out[i] = hashed.index(i, range);
+                        }
+                    },
+                    m_indices.size());
+            instruments().batch_end(start);
+        };
+
+        /**
+         * Test several values for membership. This has the same effect as
+         * calling <code>test</code> for every value, but hashes
+         * <code>batch_window</code> values ahead and prefetches all the words
+         * they touch, so that the cache misses overlap.
+         *
+         * \param values    Pointer to the first value, of type
+         *                  <code>T</code> or of a key type accepted by
+         *                  <code>test</code>
+         * \param count     Number of values
+         * \param results   Bitmap of at least <code>(count + 63) / 64</code>
+         *                  words. Bit <code>i % 64</code> of word
+         *                  <code>i / 64</code> is set to the result for the
+         *                  i-th value; the other bits of the last word are
+         *                  cleared.
+         */
+        template<typename K,
+            std::enable_if_t<batch_key<K>, int> = 0>
+        void test_batch(K const* values, size_t const count, std::uint64_t* results) const
+        {
+            auto const start = instruments().batch_start();
+            std::fill(results, results + (count + 63) / 64, 0);
+
+            size_t const k = m_indices.size();
+            window_buffer indices (batch_window * k);
+            for (size_t first = 0; first < count; first += batch_window)
+            {
+                size_t const n = std::min(batch_window, count - first);
+                hash_window(values + first, n, indices.data(), false);
+                for (size_t v = 0; v < n; ++v)
+                {
+                    bool member = true;
+                    for (size_t i = 0; i < k and member; ++i)
+                    {
+                        member = m_hash_hits.test(indices[v * k + i]);
+                    }
+                    size_t const pos = first + v;
+                    results[pos / 64] |= std::uint64_t{member} << (pos % 64);
+                }
+            }
+            instruments().tested(results, count);
+            instruments().batch_end(start);
+        };
+
+        /**
+         * Test whether another filter has the same parameters and salt
+         * values, so that the bits of both mean the same. Filters with the
+         * same number of bits, hash functions and seed are compatible, even
+         * if they were built in different processes.
+         *
+         * \param other     Other filter
+         * \return          Whether the filters can be combined
+         */
+        bool compatible(dynamic_bloom_filter const& other) const
+        {
+            return num_bits() == other.num_bits()
+                and num_hash_functions() == other.num_hash_functions()
+                and salts() == other.salts();
+        };
+
+        /**
+         * Add all values of a compatible filter. Afterwards this filter is
+         * the same as one that all values of both filters were added to.
+         *
+         * \param other     Other filter
+         * \throw std::invalid_argument if the filters are not compatible
+         */
+        void merge(dynamic_bloom_filter const& other)
+        {
+            check_compatible(other);
+            m_hash_hits.or_with(other.m_hash_hits);
+        };
+
+        /**
+         * Union with a compatible filter, see <code>merge</code>.
+         *
+         * \param other     Other filter
+         * \return          A reference to this
+         * \throw std::invalid_argument if the filters are not compatible
+         */
+        dynamic_bloom_filter& operator|= (dynamic_bloom_filter const& other)
+        {
+            merge(other);
+            return *this;
+        };
+
+        /**
+         * Intersection with a compatible filter. Every value in both filters
+         * still tests positive, but the result keeps bits that values only
+         * in one of the filters share by chance, so its false positive rate
+         * is higher than that of a filter built from the common values.
+         *
+         * \param other     Other filter
+         * \return          A reference to this
+         * \throw std::invalid_argument if the filters are not compatible
+         */
+        dynamic_bloom_filter& operator&= (dynamic_bloom_filter const& other)
+        {
+            check_compatible(other);
+            m_hash_hits.and_with(other.m_hash_hits);
+            return *this;
+        };
+
+        /**
+         * \param other     Other filter
+         * \return          Whether the filters are compatible and have the
+         *                  same bits, so they answer every test alike
+         */
+        bool operator== (dynamic_bloom_filter const& other) const
+        {
+            return compatible(other) and m_hash_hits.equals(other.m_hash_hits);
+        };
+
+        /**
+         * \param other     Other filter
+         * \return          Whether the filters differ
+         */
+        bool operator!= (dynamic_bloom_filter const& other) const
+        {
+            return not (*this == other);
+        };
+
+        /**
+         * Count the set bits. This scans the whole bit array with vector
+         * instructions, so it is limited by the memory bandwidth: a filter
+         * that fits the caches takes microseconds, a 1 GiB filter takes
+         * its size divided by the bandwidth, e.g. 0.1 s at 10 GB/s.
+         *
+         * \return      Number of set bits
+         */
+        size_t num_set_bits() const { return m_hash_hits.count(); }
+
+        /**
+         * Fraction of set bits. A filter sized with
+         * <code>optimal_parameters</code> is about half full when it holds
+         * the number of values it was sized for; the more it exceeds that,
+         * the faster its false positive rate grows. Scans the bit array,
+         * see <code>num_set_bits</code>.
+         *
+         * \return      Fill ratio in [ 0, 1 ]
+         */
+        double fill_ratio() const
+        {
+            return static_cast<double>(num_set_bits()) / static_cast<double>(num_bits());
+        };
+
+        /**
+         * Estimate the number of distinct values added, from the number of
+         * set bits <i>X</i> (Swamidass and Baldi, "Mathematical correction
+         * for fingerprint similarity measures to improve chemical
+         * retrieval"):
+         *
+         * \f[
+         *      n^* = -\frac{m}{k} \ln\left( 1 - \frac{X}{m} \right)
+         * \f]
+         *
+         * Values added more than once count once. Scans the bit array, see
+         * <code>num_set_bits</code>.
+         *
+         * \return      Estimated number of values; infinity if all bits
+         *              are set
+         */
+        double estimated_size() const
+        {
+            double const m = static_cast<double>(num_bits());
+            double const k = static_cast<double>(num_hash_functions());
+            return -m / k * std::log1p(-static_cast<double>(num_set_bits()) / m);
+        };
+
+        /**
+         * Estimate the current false positive rate from the fill ratio
+         * <i>f</i>: a value that was not added tests positive if all its
+         * <i>k</i> bits happen to be set, i.e. with probability
+         * <i>f<sup>k</sup></i>. Unlike a rate computed from the number of
+         * values the filter was sized for, this tracks how the filter
+         * actually filled up. Scans the bit array, see
+         * <code>num_set_bits</code>.
+         *
+         * \return      Estimated false positive rate in [ 0, 1 ]
+         */
+        double estimated_false_positive_rate() const
+        {
+            return std::pow(fill_ratio(), static_cast<double>(num_hash_functions()));
+        };
+
+        /**
+         * \return      Number of bits in the filter
+         */
+        size_t num_bits() const { return m_hash_hits.size(); }
+
+        /**
+         * \return      Number of hash functions used per value
+         */
+        size_t num_hash_functions() const { return m_indices.size(); }
+
+        /**
+         * \return      Salt values of the hash functions: one per hash
+         *              function with <code>independent_hashing</code>, a
+         *              single one with <code>double_hashing</code>
+         */
+        std::vector<size_t> salts() const { return m_indices.salts(); }
+
+        /**
+         * Take a snapshot of the counters of a filter with
+         * <code>counting_instrumentation</code>, e.g. to compare the
+         * observed positive rate to the false positive rate the filter was
+         * sized for. Safe to call while other threads use the filter.
+         *
+         * \return      Counts since construction or the last
+         *              <code>reset_statistics</code>
+         */
+        template<typename I = instrumentation,
+            std::enable_if_t<I::enabled, int> = 0>
+        filter_statistics statistics() const
+        {
+            return instruments().snapshot();
+        };
+
+        /**
+         * Set the counters of a filter with
+         * <code>counting_instrumentation</code> to zero.
+         */
+        template<typename I = instrumentation,
+            std::enable_if_t<I::enabled, int> = 0>
+        void reset_statistics()
+        {
+            static_cast<instrumentation&>(*this).reset();
+        };
+
+        /**
+         * Write the filter to a stream, in the format described by
+         * <code>detail::file_header</code>. Open file streams in binary
+         * mode.
+         *
+         * \param out   Stream to write to
+         * \throw std::runtime_error if writing fails
+         */
+        void save(std::ostream& out) const
+        {
+            auto const salt_values = salts();
+            auto const header = detail::make_header<hashing, hasher>(
+                    num_bits(), num_hash_functions(), salt_values.size());
+            detail::write_filter(out, header, salt_values, m_hash_hits.data());
+        };
+
+        /**
+         * Read a filter written by <code>save</code> from a stream. The
+         * filter must have been saved with the same hashing scheme and
+         * hasher.
+         *
+         * \param in            Stream to read from
+         * \param huge_pages    Whether to try to back the bits with huge
+         *                      pages
+         * \return              The filter
+         * \throw std::runtime_error if the stream does not hold a matching
+         *                      filter
+         */
+        static dynamic_bloom_filter load(std::istream& in, bool const huge_pages = false)
+        {
+            std::vector<size_t> salts;
+            auto const header = detail::read_filter_header<hashing, hasher>(in, salts);
+
+            detail::bit_array bits (header.num_bits, huge_pages);
+            if (not in.read(reinterpret_cast<char*>(bits.data()), header.data_size))
+                throw std::runtime_error("bloom filter file is truncated");
+
+            return dynamic_bloom_filter(
+                    detail::index_generator<T, hashing, hasher>(header.num_hash_functions, salts),
+                    std::move(bits));
+        };
+
+    protected:
+        /**
+         * Constructor. Restores a filter from its parts.
+         *
+         * \param indices   Index generator with the salts of the filter
+         * \param bits      Bits of the filter
+         */
+        dynamic_bloom_filter(detail::index_generator<T, hashing, hasher>&& indices,
+                detail::bit_array&& bits)
+        :   m_indices(std::move(indices)),
+            m_hash_hits(std::move(bits))
+        {
+            // ctor
+        };
+
+    private:
+        /**
+         * \param key   Value or transparent key to add
+         */
+        template<typename K>
+        void add_key(K const& key)
+        {
+            auto const hashed = m_indices.hash(key);
+            for (size_t i = 0; i < m_indices.size(); ++i)
+            {
+                m_hash_hits.set(hashed.index(i, m_hash_hits.size()));
+            }
+            instruments().added(1);
+        }
+
+        /**
+         * \param key   Value or transparent key to check for
+         * \return      Boolean value indicating membership
+         */
+        template<typename K>
+        bool test_key(K const& key) const
+        {
+            bool const member = test_bits(key);
+            instruments().tested(member);
+            return member;
+        }
+
+        /**
+         * \param key   Value or transparent key to check for
+         * \return      Boolean value indicating membership
+         */
+        template<typename K>
+        bool test_bits(K const& key) const
+        {
+            // the key may be member if the indices of all its hashes are set
+            // in the bit array
+            auto const hashed = m_indices.hash(key);
+            for (size_t i = 0; i < m_indices.size(); ++i)
+            {
+                if (not m_hash_hits.test(hashed.index(i, m_hash_hits.size())))
+                    return false;
+            }
+            return true;
+        }
+
+        /**
+         * \return      Instrumentation policy, the private base
+         */
+        instrumentation const& instruments() const
+        {
+            return *this;
+        }
+
+        /**
+         * \param other     Other filter
+         * \throw std::invalid_argument if the filters are not compatible
+         */
+        void check_compatible(dynamic_bloom_filter const& other) const
+        {
+            if (num_bits() != other.num_bits() or num_hash_functions() != other.num_hash_functions())
+                throw std::invalid_argument("bloom filters have different parameters");
+            if (not compatible(other))
+                throw std::invalid_argument("bloom filters have different salts");
+        }
+
+        /**
+         * Indices of a window of values, on the stack for up to 16 hash
+         * functions.
+         */
+        using window_buffer = detail::index_buffer<batch_window * 16>;
+
+        /**
+         * Compute all indices of a window of values and prefetch the words
+         * holding them.
+         *
+         * \param values    Pointer to the first value
+         * \param n         Number of values, at most
+         *                  <code>batch_window</code>
+         * \param indices   Output, <code>n * num_hash_functions()</code>
+         *                  indices, grouped by value
+         * \param write     Whether the words will be written
+         */
+        template<typename K>
+        void hash_window(K const* values, size_t const n, size_t* indices, bool const write) const
+        {
+            size_t const k = m_indices.size();
+            for (size_t v = 0; v < n; ++v)
+            {
+                auto const hashed = m_indices.hash(values[v]);
+                for (size_t i = 0; i < k; ++i)
+                {
+                    size_t const idx = hashed.index(i, m_hash_hits.size());
+                    indices[v * k + i] = idx;
+                    if (write) m_hash_hits.prefetch_write(idx);
+                    else m_hash_hits.prefetch_read(idx);
+                }
+            }
+        }
+
+        /**
+         * Computes the indices of a value, one per hash function.
+         */
+        detail::index_generator<T, hashing, hasher> m_indices;
+
+        /**
+         * The bits set by hash function hits.
+         */
+        detail::bit_array m_hash_hits;
+};
@@ -1,30 +1,64 @@
-#include <algorithm>
-#include <array>
-#include <bitset>
 #include <cstdint>
-#include <cstring>
-#include <functional>
 #include <limits>
-#include <random>
 #include <type_traits>
 
-#include "salted_type.hpp"
+#include "hashers.hpp"
 
 #pragma once
 
 namespace detail
 {
+    /**
+     * Seed of the salts of filters that are constructed without one.
+     */
+    constexpr std::uint64_t const default_seed = 0;
+
+    /**
+     * Next value of the SplitMix64 generator (Steele, Lea and Flood, "Fast
+     * Splittable Pseudorandom Number Generators"). Filters derive their salt
+     * values from a seed with it. Unlike the engines of the standard
+     * library, whose output may differ between implementations, its output
+     * is fixed by these few lines, so a seed yields the same salts on every
+     * platform and in every build.
+     *
+     * \param state     State of the generator, advanced by the call
+     * \return          Next value
+     */
+    constexpr std::uint64_t splitmix64(std::uint64_t& state)
+    {
+        std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    /**
+     * Map a 64-bit hash uniformly onto the range [ 0, range ) without a
+     * division. This interprets the hash as a fixed point fraction in
+     * [ 0, 1 ) and scales it by the range, so it uses the <i>high</i> bits
+     * of the hash and works for any range, not only powers of two.
+     *
+     * \param hash      Hash value
+     * \param range     Size of the target range
+     * \return          Index in [ 0, range )
+     */
+    constexpr std::uint64_t fast_range(std::uint64_t const hash, std::uint64_t const range)
+    {
+        return static_cast<std::uint64_t>(
+                (static_cast<unsigned __int128>(hash) * range) >> 64);
+    }
+
     /**
      * Represents a hash function. The function has a certain salt value and
      * represents a function
-     *      f: A -> B
-     * where A is the data type (size_t) and B is the result type (uint8_t).
+     *      f: A -> [ 0, range )
+     * where A is the data type and the range is given per call.
      */
-    template<size_t hash_precision, typename data_t = size_t>
+    template<typename data_t = size_t, typename hasher_t = wyhash_hasher>
     struct hash_fn
     {
             using salt_t = size_t;
-            using result_t = std::bitset<hash_precision>;
+            using result_t = size_t;
 
         private:
             /**
@@ -35,42 +69,75 @@ namespace detail
             salt_t m_salt;
 
             /**
-             * std::hash used for hashing.
+             * Hasher used for hashing, see <code>wyhash_hasher</code>.
              */
-            std::hash<salted_type<data_t>> m_hash_fn;
+            hasher_t m_hasher;
 
         public:
             /*
-             * Assert that the result type has less or equal to the amount of
-             * digits of std::hash. This is essential as we could not guarantee
-             * equal distribution of hash values otherwise. It should always be
-             * given as result_t is of type uint8_t.
+             * Assert that size_t is a full 64-bit word, which is what the
+             * reduction to an index expects.
              */
-            static_assert(hash_precision <= std::numeric_limits<size_t>::digits,
-                    "Result type must have less or equal amount of bits as std::hash.");
+            static_assert(std::numeric_limits<size_t>::digits == 64,
+                    "Hash values must be 64 bits wide.");
 
             /**
-             * Hash a data value.
+             * Hash a data value to a full-width hash. The hasher must spread
+             * the value over the high bits, which are the ones used by
+             * <code>fast_range</code>.
              *
-             * \param _p1   Data value
-             * \return      Hash value
+             * \param data  Data value
+             * \return      64-bit hash value
              */
-            result_t operator()(data_t const& data) const
+            std::uint64_t hash(data_t const& data) const
             {
-                salted_type<data_t> s {data, m_salt};
-                auto hash = m_hash_fn(s);
-
-                // properly reduce the size_t to a uint8_t
-                result_t result;
-                result.reset();
-                std::bitset<8*sizeof(hash)> intermediate (hash);
-                for (size_t i = 0; i < intermediate.size(); ++i)
-                {
-                    size_t const idx = i % result.size();
-                    if (intermediate.test(i)) result.flip(idx);
-                }
-
-                return result;
+                return m_hasher(data, m_salt);
+            }
+
+            /**
+             * Hash a key of another type that the hasher hashes exactly like
+             * the equal data value, see <code>is_transparent_key</code>.
+             *
+             * \param key   Key
+             * \return      64-bit hash value
+             */
+            template<typename key_t,
+                typename = std::enable_if_t<is_transparent_key_v<data_t, key_t, hasher_t>>>
+            std::uint64_t hash(key_t const& key) const
+            {
+                return m_hasher(key, m_salt);
+            }
+
+            /**
+             * \return      Salt value of the hash function
+             */
+            salt_t salt() const { return m_salt; }
+
+            /**
+             * Hash a data value to an index.
+             *
+             * \param data  Data value
+             * \param range Number of possible indices
+             * \return      Index in [ 0, range )
+             */
+            result_t operator()(data_t const& data, size_t const range) const
+            {
+                return fast_range(hash(data), range);
+            }
+
+            /**
+             * Hash a key of another type to an index, see
+             * <code>hash</code>.
+             *
+             * \param key   Key
+             * \param range Number of possible indices
+             * \return      Index in [ 0, range )
+             */
+            template<typename key_t,
+                typename = std::enable_if_t<is_transparent_key_v<data_t, key_t, hasher_t>>>
+            result_t operator()(key_t const& key, size_t const range) const
+            {
+                return fast_range(hash(key), range);
             }
 
             /**
@@ -85,27 +152,27 @@ namespace detail
             }
 
             /**
-             * Move constructor.
+             * Copy constructor.
              *
-             * \param other     Other hash_fn object (moved from)
+             * \param other     Other hash_fn object
              */
-            hash_fn(hash_fn&& other)
+            hash_fn(hash_fn const& other)
             :   m_salt(other.m_salt),
-                m_hash_fn(other.m_hash_fn)
+                m_hasher(other.m_hasher)
             {
                 // ctor
             }
 
             /**
-             * Move assignment operator.
+             * Copy assignment operator.
              *
-             * \param other     Other hash_fn object (moved from)
+             * \param other     Other hash_fn object
              * \return          A reference to this
              */
-            hash_fn& operator= (hash_fn&& other)
+            hash_fn& operator= (hash_fn const& other)
             {
                 m_salt = other.m_salt;
-                m_hash_fn = other.m_hash_fn;
+                m_hasher = other.m_hasher;
 
                 return *this;
             }
@@ -120,4 +187,105 @@ namespace detail
                 // dtor
             }
     }; // struct hash_fn
+
+    /**
+     * Represents a hash function that hashes a value once and yields two
+     * independent 64-bit hashes. These are combined as
+     *      h1 + i * h2 + i * (i - 1) / 2 * h3
+     * to derive any number of indices (Kirsch and Mitzenmacher, "Less
+     * Hashing, Same Performance: Building a Better Bloom Filter", with the
+     * quadratic term of Dillinger and Manolios' triple hashing), so the
+     * value itself is only hashed once no matter how many indices are needed.
+     */
+    template<typename data_t = size_t, typename hasher_t = wyhash_hasher>
+    struct double_hash_fn
+    {
+            using salt_t = size_t;
+
+        private:
+            /**
+             * Salt value to be applied before hashing.
+             */
+            salt_t m_salt;
+
+            /**
+             * Hasher used for hashing, see <code>wyhash_hasher</code>.
+             */
+            hasher_t m_hasher;
+
+        public:
+            /**
+             * Hash a data value once into 128 bits. The second half is made
+             * odd, so the derived indices do not repeat for a power of two
+             * number of steps.
+             *
+             * \param data  Data value
+             * \return      Pair of hash values
+             */
+            hash_pair operator()(data_t const& data) const
+            {
+                return hash128(data);
+            }
+
+            /**
+             * Hash a key of another type that the hasher hashes exactly like
+             * the equal data value, see <code>is_transparent_key</code>.
+             *
+             * \param key   Key
+             * \return      Pair of hash values
+             */
+            template<typename key_t,
+                typename = std::enable_if_t<is_transparent_key_v<data_t, key_t, hasher_t>>>
+            hash_pair operator()(key_t const& key) const
+            {
+                return hash128(key);
+            }
+
+            /**
+             * \return      Salt value of the hash function
+             */
+            salt_t salt() const { return m_salt; }
+
+            /**
+             * Derive the i-th index from a pair of hash values.
+             *
+             * \param hash  Pair of hash values
+             * \param i     Number of the index
+             * \param range Number of possible indices
+             * \return      Index in [ 0, range )
+             */
+            static size_t index(hash_pair const& hash, size_t const i, size_t const range)
+            {
+                // In small ranges, such as the block of a blocked filter, the
+                // plain progression h1 + i * h2 often repeats itself, and
+                // values that share a block also share the high bits of h1.
+                // The quadratic term breaks up the progression. h3 is h1
+                // with its halves swapped, so that it does not depend on the
+                // bits that selected the block.
+                std::uint64_t const h3 = (hash.h1 << 32) | (hash.h1 >> 32);
+                return fast_range(hash.h1 + i * hash.h2 + i * (i - 1) / 2 * h3, range);
+            }
+
+            /**
+             * Constructor.
+             *
+             * \param salt_value    Salt value to be used for hashing
+             */
+            double_hash_fn(salt_t const salt_value)
+            :   m_salt(salt_value)
+            {
+                // ctor
+            }
+
+            double_hash_fn() : double_hash_fn(0) {};
+
+        private:
+            template<typename key_t>
+            hash_pair hash128(key_t const& key) const
+            {
+                auto hash = m_hasher.hash128(key, m_salt);
+                hash.h2 |= 1u;
+                return hash;
+            }
+    }; // struct double_hash_fn
 } // namespace detail
@@ -0,0 +1,310 @@
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "salted_type.hpp"
+
+#pragma once
+
+namespace detail
+{
+    /**
+     * Odd multiplier for multiply-shift hashing, 2^64 divided by the golden
+     * ratio. Multiplying by it spreads every input bit into the high bits of
+     * the product.
+     */
+    constexpr std::uint64_t const multiply_shift_constant = 0x9e3779b97f4a7c15ull;
+
+    /**
+     * Finalizer of MurmurHash3. Mixes a 64-bit word so that every input bit
+     * affects every output bit with probability close to one half.
+     *
+     * \param x     Word to mix
+     * \return      Mixed word
+     */
+    inline std::uint64_t mix64(std::uint64_t x)
+    {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdull;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ull;
+        x ^= x >> 33;
+        return x;
+    }
+
+    /**
+     * A 128-bit hash value, split into two 64-bit halves.
+     */
+    struct hash_pair
+    {
+        std::uint64_t h1;
+        std::uint64_t h2;
+    };
+
+    /**
+     * Building blocks of wyhash (final version 4, by Wang Yi, released into
+     * the public domain). The function is reimplemented here instead of
+     * pulling in the upstream header; its output is not guaranteed to match
+     * upstream test vectors.
+     */
+    namespace wy
+    {
+        /**
+         * Default secret of wyhash.
+         */
+        constexpr std::uint64_t const secret[4] = {
+            0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+            0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull
+        };
+
+        /**
+         * Multiply two words to 128 bits and return the halves in place.
+         */
+        inline void mum(std::uint64_t& a, std::uint64_t& b)
+        {
+            unsigned __int128 r = a;
+            r *= b;
+            a = static_cast<std::uint64_t>(r);
+            b = static_cast<std::uint64_t>(r >> 64);
+        }
+
+        /**
+         * Multiply two words to 128 bits and fold the halves.
+         */
+        inline std::uint64_t mix(std::uint64_t a, std::uint64_t b)
+        {
+            mum(a, b);
+            return a ^ b;
+        }
+
+        inline std::uint64_t read8(unsigned char const* p)
+        {
+            std::uint64_t v;
+            std::memcpy(&v, p, 8);
+            return v;
+        }
+
+        inline std::uint64_t read4(unsigned char const* p)
+        {
+            std::uint32_t v;
+            std::memcpy(&v, p, 4);
+            return v;
+        }
+
+        inline std::uint64_t read3(unsigned char const* p, size_t const k)
+        {
+            return (std::uint64_t{p[0]} << 16) | (std::uint64_t{p[k >> 1]} << 8) | p[k - 1];
+        }
+
+        /**
+         * Absorb a byte string into the two state words that the final
+         * mixing step of wyhash consumes.
+         *
+         * \param key   Pointer to the bytes
+         * \param len   Number of bytes
+         * \param seed  Seed value
+         * \return      State words <code>a</code> and <code>b</code>
+         */
+        inline hash_pair absorb(void const* key, size_t const len, std::uint64_t seed)
+        {
+            auto const* p = static_cast<unsigned char const*>(key);
+            seed ^= mix(seed ^ secret[0], secret[1]);
+            std::uint64_t a;
+            std::uint64_t b;
+            if (len <= 16)
+            {
+                if (len >= 4)
+                {
+                    a = (read4(p) << 32) | read4(p + ((len >> 3) << 2));
+                    b = (read4(p + len - 4) << 32) | read4(p + len - 4 - ((len >> 3) << 2));
+                }
+                else if (len > 0)
+                {
+                    a = read3(p, len);
+                    b = 0;
+                }
+                else
+                {
+                    a = b = 0;
+                }
+            }
+            else
+            {
+                size_t i = len;
+                if (i > 48)
+                {
+                    std::uint64_t see1 = seed;
+                    std::uint64_t see2 = seed;
+                    do
+                    {
+                        seed = mix(read8(p) ^ secret[1], read8(p + 8) ^ seed);
+                        see1 = mix(read8(p + 16) ^ secret[2], read8(p + 24) ^ see1);
+                        see2 = mix(read8(p + 32) ^ secret[3], read8(p + 40) ^ see2);
+                        p += 48;
+                        i -= 48;
+                    } while (i > 48);
+                    seed ^= see1 ^ see2;
+                }
+                while (i > 16)
+                {
+                    seed = mix(read8(p) ^ secret[1], read8(p + 8) ^ seed);
+                    i -= 16;
+                    p += 16;
+                }
+                a = read8(p + i - 16);
+                b = read8(p + i - 8);
+            }
+            a ^= secret[1];
+            b ^= seed;
+            mum(a, b);
+            return { a ^ secret[0] ^ len, b ^ secret[1] };
+        }
+    } // namespace wy
+} // namespace detail
+
+/**
+ * Hasher based on <code>std::hash</code>. The salt is combined with the hash
+ * of the value as in <code>salted_type</code>, so any type with a
+ * <code>std::hash</code> specialization can be used. Byte strings of any type
+ * (<code>std::string</code>, <code>std::string_view</code>, character
+ * pointers) are hashed as <code>std::string_view</code>, which the standard
+ * guarantees to hash like the equal <code>std::string</code>.
+ *
+ * Note that for integers most standard libraries implement
+ * <code>std::hash</code> as the identity, so with this hasher sequential
+ * integer keys are only spread by a single multiplication. Prefer
+ * <code>wyhash_hasher</code> unless bit-for-bit compatibility with
+ * <code>std::hash</code> is needed.
+ *
+ * A hasher provides a 64-bit hash and a 128-bit hash of a value for a given
+ * seed:
+ * \code
+ *      std::uint64_t operator()(T const& value, std::uint64_t seed) const;
+ *      detail::hash_pair hash128(T const& value, std::uint64_t seed) const;
+ * \endcode
+ * A hasher that hashes all byte strings alike, so that e.g. a
+ * <code>std::string_view</code> has the same hash as the equal
+ * <code>std::string</code>, declares <code>is_transparent</code>. Filters of
+ * strings then accept any byte string for lookups, without converting it.
+ */
+struct std_hasher
+{
+    using is_transparent = void;
+
+    template<typename T>
+    std::uint64_t operator()(T const& value, std::uint64_t const seed) const
+    {
+        return salted(value, seed) * detail::multiply_shift_constant;
+    }
+
+    template<typename T>
+    detail::hash_pair hash128(T const& value, std::uint64_t const seed) const
+    {
+        auto const hash = salted(value, seed);
+        return { hash * detail::multiply_shift_constant, detail::mix64(hash) };
+    }
+
+    private:
+        /**
+         * \param value     Value to hash
+         * \param seed      Seed value
+         * \return          Salted <code>std::hash</code> of the value
+         */
+        template<typename T>
+        static std::size_t salted(T const& value, std::uint64_t const seed)
+        {
+            if constexpr (std::is_convertible_v<T const&, std::string_view>)
+                return detail::salt_hash(std::hash<std::string_view>{}(value), seed);
+            else
+                return detail::salt_hash(std::hash<T>{}(value), seed);
+        }
+};
+
+/**
+ * Fast, high quality hasher based on wyhash. Byte strings
+ * (<code>std::string</code> and <code>std::string_view</code>) are hashed
+ * from their bytes, and integral and enum types from their value. Every
+ * other type falls back to its <code>std::hash</code> specialization, whose
+ * result is then mixed with the seed, so user types only need to provide
+ * <code>std::hash</code>. All byte strings are hashed alike, so the hasher is
+ * transparent, see <code>std_hasher</code>.
+ */
+struct wyhash_hasher
+{
+    using is_transparent = void;
+
+    template<typename T>
+    std::uint64_t operator()(T const& value, std::uint64_t const seed) const
+    {
+        auto const state = absorb(value, seed);
+        return detail::wy::mix(state.h1, state.h2);
+    }
+
+    template<typename T>
+    detail::hash_pair hash128(T const& value, std::uint64_t const seed) const
+    {
+        auto const state = absorb(value, seed);
+        return {
+            detail::wy::mix(state.h1, state.h2),
+            detail::wy::mix(state.h1 ^ detail::wy::secret[2], state.h2 ^ detail::wy::secret[3])
+        };
+    }
+
+    private:
+        /**
+         * Absorb a value into the wyhash state.
+         *
+         * \param value     Value to hash
+         * \param seed      Seed value
+         * \return          State words for the final mixing step
+         */
+        template<typename T>
+        static detail::hash_pair absorb(T const& value, std::uint64_t const seed)
+        {
+            if constexpr (std::is_integral_v<T> or std::is_enum_v<T>)
+            {
+                auto const v = static_cast<std::uint64_t>(value);
+                std::uint64_t a = v ^ detail::wy::secret[0];
+                std::uint64_t b = seed ^ detail::wy::secret[1];
+                detail::wy::mum(a, b);
+                return { a ^ detail::wy::secret[0], b ^ detail::wy::secret[1] };
+            }
+            else if constexpr (std::is_convertible_v<T const&, std::string_view>)
+            {
+                std::string_view const bytes (value);
+                return detail::wy::absorb(bytes.data(), bytes.size(), seed);
+            }
+            else
+            {
+                std::uint64_t a = std::hash<T>{}(value) ^ detail::wy::secret[0];
+                std::uint64_t b = seed ^ detail::wy::secret[1];
+                detail::wy::mum(a, b);
+                return { a ^ detail::wy::secret[0], b ^ detail::wy::secret[1] };
+            }
+        }
+};
+
+namespace detail
+{
+    /**
+     * Whether a filter of <code>T</code> using <code>hasher</code> can look
+     * up keys of another type <code>K</code> without converting them to
+     * <code>T</code>: both are byte strings, and the hasher is transparent,
+     * so it hashes a key exactly like the equal value of type <code>T</code>.
+     */
+    template<typename T, typename K, typename hasher, typename = void>
+    struct is_transparent_key : std::false_type {};
+
+    template<typename T, typename K, typename hasher>
+    struct is_transparent_key<T, K, hasher, std::void_t<typename hasher::is_transparent>>
+    :   std::bool_constant<not std::is_same_v<T, K>
+            and std::is_convertible_v<T const&, std::string_view>
+            and std::is_convertible_v<K const&, std::string_view>>
+    {};
+
+    template<typename T, typename K, typename hasher>
+    constexpr bool const is_transparent_key_v = is_transparent_key<T, K, hasher>::value;
+} // namespace detail
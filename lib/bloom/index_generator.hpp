@@ -0,0 +1,289 @@
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "hash_fn.hpp"
+
+#pragma once
+
+/**
+ * Hashing scheme tag: every index of a value is computed by its own salted
+ * hash function, so a value is hashed once per index. This is the classic
+ * bloom filter construction.
+ */
+struct independent_hashing {};
+
+/**
+ * Hashing scheme tag: a value is hashed once into 128 bits and all indices
+ * are derived from that by double hashing. This is much cheaper for values
+ * that are expensive to hash, such as long strings, and has no measurable
+ * effect on the false positive rate.
+ */
+struct double_hashing {};
+
+/**
+ * Seed from which a filter derives the salt values of its hash functions.
+ * Filters constructed with the same seed and parameters have the same salts
+ * on every host and with every standard library, so they can be built in
+ * different processes and then merged, or shipped to other hosts. Filters
+ * constructed without a seed use seed 0.
+ */
+struct filter_seed
+{
+    std::uint64_t value;
+};
+
+namespace detail
+{
+    /**
+     * Computes the indices of a value for a given hashing scheme. A filter
+     * calls <code>hash</code> once per value, and then asks the result for
+     * the indices it needs with <code>index(i, range)</code>.
+     */
+    template<typename data_t, typename hashing, typename hasher_t = wyhash_hasher>
+    class index_generator;
+
+    template<typename data_t, typename hasher_t>
+    class index_generator<data_t, independent_hashing, hasher_t>
+    {
+        public:
+            /**
+             * Hashed value. Indices are computed lazily, so a lookup that
+             * fails early does not pay for the remaining hash functions.
+             */
+            template<typename key_t>
+            struct hashed_key
+            {
+                index_generator const& generator;
+                key_t const& value;
+
+                /**
+                 * \param i     Number of the index, less than
+                 *              <code>size()</code>
+                 * \param range Number of possible indices
+                 * \return      The i-th index of the value in [ 0, range )
+                 */
+                size_t index(size_t const i, size_t const range) const
+                {
+                    return generator.m_hash_functions[i](value, range);
+                }
+            };
+
+            using hashed = hashed_key<data_t>;
+
+            /**
+             * Constructor. Derives the salt values of all hash functions
+             * from a seed.
+             *
+             * \param num_indices   Number of indices per value
+             * \param seed          Seed of the salt values
+             */
+            explicit index_generator(size_t const num_indices,
+                    std::uint64_t seed = default_seed)
+            :   m_hash_functions()
+            {
+                m_hash_functions.reserve(num_indices);
+                for (size_t i = 0; i < num_indices; ++i)
+                {
+                    m_hash_functions.emplace_back(splitmix64(seed));
+                }
+            }
+
+            /**
+             * Constructor. Restores the hash functions from their salt
+             * values, e.g. when loading a saved filter.
+             *
+             * \param num_indices   Number of indices per value
+             * \param salts         Salt values, one per index
+             */
+            index_generator(size_t const num_indices, std::vector<size_t> const& salts)
+            :   m_hash_functions(salts.begin(), salts.end())
+            {
+                if (salts.size() != num_indices)
+                    throw std::invalid_argument("need one salt value per index");
+            }
+
+            /**
+             * \param value     Value to hash
+             * \return          Hashed value
+             */
+            hashed hash(data_t const& value) const
+            {
+                return { *this, value };
+            }
+
+            /**
+             * \param key       Key of another type that hashes like the equal
+             *                  value, see <code>is_transparent_key</code>
+             * \return          Hashed key
+             */
+            template<typename key_t,
+                typename = std::enable_if_t<detail::is_transparent_key_v<data_t, key_t, hasher_t>>>
+            hashed_key<key_t> hash(key_t const& key) const
+            {
+                return { *this, key };
+            }
+
+            /**
+             * \return      Number of indices per value
+             */
+            size_t size() const { return m_hash_functions.size(); }
+
+            /**
+             * \return      Salt values of the hash functions, one per index
+             */
+            std::vector<size_t> salts() const
+            {
+                std::vector<size_t> result;
+                for (auto const& fn : m_hash_functions) result.push_back(fn.salt());
+                return result;
+            }
+
+        private:
+            /**
+             * The hash functions, one per index. All hash functions ideally
+             * should have different salt values. This is currently not
+             * enforced.
+             */
+            std::vector<hash_fn<data_t, hasher_t>> m_hash_functions;
+    };
+
+    template<typename data_t, typename hasher_t>
+    class index_generator<data_t, double_hashing, hasher_t>
+    {
+        public:
+            /**
+             * Hashed value. Holds the 128-bit hash the indices are derived
+             * from.
+             */
+            struct hashed
+            {
+                hash_pair hash;
+
+                /**
+                 * \param i     Number of the index, less than
+                 *              <code>size()</code>
+                 * \param range Number of possible indices
+                 * \return      The i-th index of the value in [ 0, range )
+                 */
+                size_t index(size_t const i, size_t const range) const
+                {
+                    return double_hash_fn<data_t, hasher_t>::index(hash, i, range);
+                }
+            };
+
+            /**
+             * Constructor. Derives the salt value of the hash function from
+             * a seed.
+             *
+             * \param num_indices   Number of indices per value
+             * \param seed          Seed of the salt value
+             */
+            explicit index_generator(size_t const num_indices,
+                    std::uint64_t seed = default_seed)
+            :   m_hash_function(splitmix64(seed)),
+                m_num_indices(num_indices)
+            {
+                // ctor
+            }
+
+            /**
+             * Constructor. Restores the hash function from its salt value,
+             * e.g. when loading a saved filter.
+             *
+             * \param num_indices   Number of indices per value
+             * \param salts         Salt value of the single hash function
+             */
+            index_generator(size_t const num_indices, std::vector<size_t> const& salts)
+            :   m_hash_function(),
+                m_num_indices(num_indices)
+            {
+                if (salts.size() != 1)
+                    throw std::invalid_argument("double hashing needs exactly one salt value");
+                m_hash_function = double_hash_fn<data_t, hasher_t>(salts.front());
+            }
+
+            /**
+             * \param value     Value to hash
+             * \return          Hashed value
+             */
+            hashed hash(data_t const& value) const
+            {
+                return { m_hash_function(value) };
+            }
+
+            /**
+             * \param key       Key of another type that hashes like the equal
+             *                  value, see <code>is_transparent_key</code>
+             * \return          Hashed key
+             */
+            template<typename key_t,
+                typename = std::enable_if_t<detail::is_transparent_key_v<data_t, key_t, hasher_t>>>
+            hashed hash(key_t const& key) const
+            {
+                return { m_hash_function(key) };
+            }
+
+            /**
+             * \return      Number of indices per value
+             */
+            size_t size() const { return m_num_indices; }
+
+            /**
+             * \return      Salt value of the hash function, as a single
+             *              element
+             */
+            std::vector<size_t> salts() const
+            {
+                return { m_hash_function.salt() };
+            }
+
+        private:
+            /**
+             * The single hash function all indices are derived from.
+             */
+            double_hash_fn<data_t, hasher_t> m_hash_function;
+
+            /**
+             * Number of indices per value.
+             */
+            size_t m_num_indices;
+    };
+
+    /**
+     * Scratch space for the indices of one or more values. Up to
+     * <code>inline_size</code> indices live in the object itself, so the
+     * usual numbers of hash functions need no heap allocation; only larger
+     * buffers fall back to the heap.
+     */
+    template<size_t inline_size>
+    class index_buffer
+    {
+        public:
+            /**
+             * \param size  Number of indices to hold
+             */
+            explicit index_buffer(size_t const size)
+            :   m_heap(size > inline_size ? size : 0)
+            {
+                // ctor
+            }
+
+            /**
+             * \return      Pointer to the first index
+             */
+            size_t* data() { return m_heap.empty() ? m_inline.data() : m_heap.data(); }
+
+            /**
+             * \param i     Position of an index
+             * \return      Reference to the index
+             */
+            size_t& operator[] (size_t const i) { return data()[i]; }
+
+        private:
+            std::array<size_t, inline_size> m_inline;
+            std::vector<size_t> m_heap;
+    };
+} // namespace detail
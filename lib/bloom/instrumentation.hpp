@@ -0,0 +1,298 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "word_kernels.hpp"
+
+#pragma once
+
+/**
+ * Counts of the operations on a filter, as taken by
+ * <code>counting_instrumentation::snapshot</code>.
+ */
+struct filter_statistics
+{
+    /**
+     * Number of values added, singly or in batches.
+     */
+    std::uint64_t adds;
+
+    /**
+     * Number of values tested, singly or in batches.
+     */
+    std::uint64_t tests;
+
+    /**
+     * Number of tests that answered <code>true</code>.
+     */
+    std::uint64_t positives;
+
+    /**
+     * Number of calls of <code>add_batch</code>, <code>test_batch</code> and
+     * <code>build</code>.
+     */
+    std::uint64_t batches;
+
+    /**
+     * Total time spent in these calls.
+     */
+    std::uint64_t batch_nanoseconds;
+
+    /**
+     * Fraction of positive tests. If the probed values are rarely members,
+     * this is the observed false positive rate; compare it to the rate the
+     * filter was sized for, or to
+     * <code>dynamic_bloom_filter::estimated_false_positive_rate</code>.
+     *
+     * \return      Positive rate, 0 if nothing was tested
+     */
+    double positive_rate() const
+    {
+        return tests == 0 ? 0 : static_cast<double>(positives) / static_cast<double>(tests);
+    }
+
+    /**
+     * \return      Mean time of a batch call in nanoseconds, 0 if there was
+     *              none
+     */
+    double mean_batch_nanoseconds() const
+    {
+        return batches == 0 ? 0 : static_cast<double>(batch_nanoseconds) / static_cast<double>(batches);
+    }
+};
+
+/**
+ * Instrumentation policy of filters that records nothing. All its hooks are
+ * empty and it has no state, so a filter using it has the same size and
+ * code as one without instrumentation. This is the default.
+ *
+ * An instrumentation policy provides the following hooks, which filters
+ * call from const and non-const members alike:
+ * \code
+ *      static constexpr bool const enabled;
+ *      void added(size_t count) const;
+ *      void tested(bool result) const;
+ *      void tested(std::uint64_t const* results, size_t count) const;
+ *      batch_start_t batch_start() const;
+ *      void batch_end(batch_start_t start) const;
+ * \endcode
+ */
+struct no_instrumentation
+{
+    static constexpr bool const enabled = false;
+
+    /**
+     * Start of a batch call; nothing is measured.
+     */
+    struct batch_start_t {};
+
+    void added(size_t) const {}
+    void tested(bool) const {}
+    void tested(std::uint64_t const*, size_t) const {}
+    batch_start_t batch_start() const { return {}; }
+    void batch_end(batch_start_t) const {}
+};
+
+namespace detail
+{
+    /**
+     * Index of the calling thread among all threads that ever asked for
+     * it. Threads are numbered in the order of their first call, so
+     * threads that run at the same time get different numbers.
+     *
+     * \return      Index of the calling thread
+     */
+    inline size_t this_thread_index()
+    {
+        static std::atomic<size_t> next_index (0);
+        thread_local size_t const index = next_index.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+} // namespace detail
+
+/**
+ * Instrumentation policy of filters that counts added values, tests,
+ * positive tests and batch calls and measures the time of the latter.
+ *
+ * The counters are sharded by thread: each thread increments the counters
+ * of its own shard, which lives on a cache line of its own, so threads
+ * testing a shared filter do not contend for the counters. Up to
+ * <code>num_shards</code> concurrent threads never share a shard; beyond
+ * that threads share shards, which is still correct, only slower.
+ * <code>snapshot</code> sums all shards.
+ *
+ * Copying a filter copies the counts; a moved-from filter must not be used
+ * other than to assign to or destroy it.
+ */
+class counting_instrumentation
+{
+    public:
+        static constexpr bool const enabled = true;
+
+        /**
+         * Number of counter shards.
+         */
+        static constexpr size_t const num_shards = 64;
+
+        /**
+         * Start time of a batch call.
+         */
+        using batch_start_t = std::chrono::steady_clock::time_point;
+
+        counting_instrumentation()
+        :   m_shards(new shard[num_shards])
+        {
+            // ctor
+        };
+
+        counting_instrumentation(counting_instrumentation const& other)
+        :   counting_instrumentation()
+        {
+            store(other.snapshot());
+        };
+
+        counting_instrumentation(counting_instrumentation&&) = default;
+
+        counting_instrumentation& operator= (counting_instrumentation const& other)
+        {
+            if (this != &other)
+            {
+                filter_statistics const counts = other.snapshot();
+                reset();
+                store(counts);
+            }
+            return *this;
+        };
+
+        counting_instrumentation& operator= (counting_instrumentation&&) = default;
+
+        /**
+         * \param count     Number of values added
+         */
+        void added(size_t const count) const
+        {
+            local().adds.fetch_add(count, std::memory_order_relaxed);
+        }
+
+        /**
+         * \param result    Result of a test
+         */
+        void tested(bool const result) const
+        {
+            shard& own = local();
+            own.tests.fetch_add(1, std::memory_order_relaxed);
+            if (result) own.positives.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /**
+         * \param results   Result bitmap of a batch test, see
+         *                  <code>dynamic_bloom_filter::test_batch</code>
+         * \param count     Number of values tested
+         */
+        void tested(std::uint64_t const* results, size_t const count) const
+        {
+            shard& own = local();
+            own.tests.fetch_add(count, std::memory_order_relaxed);
+            own.positives.fetch_add(detail::words::select_popcount()(results, (count + 63) / 64),
+                    std::memory_order_relaxed);
+        }
+
+        /**
+         * \return      Start time of a batch call
+         */
+        batch_start_t batch_start() const
+        {
+            return std::chrono::steady_clock::now();
+        }
+
+        /**
+         * \param start     Start time of the batch call that ends
+         */
+        void batch_end(batch_start_t const start) const
+        {
+            auto const elapsed = std::chrono::steady_clock::now() - start;
+            shard& own = local();
+            own.batches.fetch_add(1, std::memory_order_relaxed);
+            own.batch_nanoseconds.fetch_add(static_cast<std::uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()),
+                    std::memory_order_relaxed);
+        }
+
+        /**
+         * Sum the counters of all threads. Operations that run concurrently
+         * may or may not be included.
+         *
+         * \return      Counts since construction or the last
+         *              <code>reset</code>
+         */
+        filter_statistics snapshot() const
+        {
+            filter_statistics counts {};
+            for (size_t s = 0; s < num_shards; ++s)
+            {
+                shard const& from = m_shards[s];
+                counts.adds += from.adds.load(std::memory_order_relaxed);
+                counts.tests += from.tests.load(std::memory_order_relaxed);
+                counts.positives += from.positives.load(std::memory_order_relaxed);
+                counts.batches += from.batches.load(std::memory_order_relaxed);
+                counts.batch_nanoseconds += from.batch_nanoseconds.load(std::memory_order_relaxed);
+            }
+            return counts;
+        }
+
+        /**
+         * Set all counters to zero. Operations that run concurrently may or
+         * may not be counted afterwards.
+         */
+        void reset()
+        {
+            for (size_t s = 0; s < num_shards; ++s)
+            {
+                shard& to = m_shards[s];
+                to.adds.store(0, std::memory_order_relaxed);
+                to.tests.store(0, std::memory_order_relaxed);
+                to.positives.store(0, std::memory_order_relaxed);
+                to.batches.store(0, std::memory_order_relaxed);
+                to.batch_nanoseconds.store(0, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        /**
+         * Counters of one or more threads, on a cache line of their own.
+         */
+        struct alignas(64) shard
+        {
+            std::atomic<std::uint64_t> adds { 0 };
+            std::atomic<std::uint64_t> tests { 0 };
+            std::atomic<std::uint64_t> positives { 0 };
+            std::atomic<std::uint64_t> batches { 0 };
+            std::atomic<std::uint64_t> batch_nanoseconds { 0 };
+        };
+
+        /**
+         * \return      Shard of the calling thread
+         */
+        shard& local() const
+        {
+            return m_shards[detail::this_thread_index() % num_shards];
+        }
+
+        /**
+         * Put counts into the first shard, which must be zero.
+         *
+         * \param counts    Counts to store
+         */
+        void store(filter_statistics const& counts)
+        {
+            m_shards[0].adds.store(counts.adds, std::memory_order_relaxed);
+            m_shards[0].tests.store(counts.tests, std::memory_order_relaxed);
+            m_shards[0].positives.store(counts.positives, std::memory_order_relaxed);
+            m_shards[0].batches.store(counts.batches, std::memory_order_relaxed);
+            m_shards[0].batch_nanoseconds.store(counts.batch_nanoseconds, std::memory_order_relaxed);
+        }
+
+        std::unique_ptr<shard[]> m_shards;
+}; // class counting_instrumentation
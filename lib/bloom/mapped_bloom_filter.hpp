@@ -0,0 +1,147 @@
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "bit_array.hpp"
+#include "dynamic_bloom_filter.hpp"
+#include "serialization.hpp"
+
+#pragma once
+
+/**
+ * Read-only bloom filter that is queried in place from a file written by
+ * <code>dynamic_bloom_filter::save</code>. Opening the file only maps it
+ * into memory and reads its header, so it takes constant time regardless of
+ * the size of the filter; the bits are paged in on demand by the probes.
+ * Every process that maps the same file shares its pages in the page cache.
+ *
+ * The filter answers exactly as the saved filter did. Like a
+ * <code>const</code> <code>dynamic_bloom_filter</code>, it can be tested by
+ * any number of threads concurrently.
+ *
+ * \param T         Template parameter for the type the filter was built for.
+ * \param hashing   Hashing scheme the filter was built with.
+ * \param hasher    Hasher the filter was built with.
+ */
+template<typename T, typename hashing = independent_hashing,
+    typename hasher = wyhash_hasher>
+class mapped_bloom_filter
+{
+    public:
+        /**
+         * Constructor. Maps the file and checks its header.
+         *
+         * \param path  Path of a file written by
+         *              <code>dynamic_bloom_filter::save</code>
+         * \throw std::system_error if the file can not be mapped
+         * \throw std::runtime_error if the file does not hold a matching
+         *              filter
+         */
+        explicit mapped_bloom_filter(std::string const& path)
+        :   m_file(path),
+            m_filter(open_filter(m_file))
+        {
+            // ctor
+        };
+
+        /**
+         * Test whether a value is in the filter, see
+         * <code>dynamic_bloom_filter::test</code>.
+         *
+         * \param t     Data item to check for
+         * \return      Boolean value indicating membership
+         */
+        bool test(T const& t) const
+        {
+            return m_filter.test(t);
+        };
+
+        /**
+         * Test whether a key of another type is in the filter, see
+         * <code>dynamic_bloom_filter::test</code>.
+         *
+         * \param key   Key to check for
+         * \return      Boolean value indicating membership
+         */
+        template<typename K,
+            std::enable_if_t<detail::is_transparent_key_v<T, K, hasher>, int> = 0>
+        bool test(K const& key) const
+        {
+            return m_filter.test(key);
+        };
+
+        /**
+         * Test several values for membership, see
+         * <code>dynamic_bloom_filter::test_batch</code>.
+         *
+         * \param values    Pointer to the first value, of type
+         *                  <code>T</code> or a transparent key type
+         * \param count     Number of values
+         * \param results   Bitmap of at least <code>(count + 63) / 64</code>
+         *                  words
+         */
+        template<typename K,
+            std::enable_if_t<std::is_same_v<K, T> or detail::is_transparent_key_v<T, K, hasher>, int> = 0>
+        void test_batch(K const* values, size_t const count, std::uint64_t* results) const
+        {
+            m_filter.test_batch(values, count, results);
+        };
+
+        /**
+         * \return      Number of bits in the filter
+         */
+        size_t num_bits() const { return m_filter.num_bits(); }
+
+        /**
+         * \return      Number of hash functions used per value
+         */
+        size_t num_hash_functions() const { return m_filter.num_hash_functions(); }
+
+    private:
+        using filter_t = dynamic_bloom_filter<T, hashing, hasher>;
+
+        /**
+         * Build a filter whose bits are the mapped bit array of a file.
+         *
+         * \param file  Mapped file
+         * \return      Filter viewing the file
+         */
+        static filter_t open_filter(detail::mapped_file const& file)
+        {
+            auto const* bytes = static_cast<char const*>(file.data());
+            if (file.size() < sizeof(detail::file_header))
+                throw std::runtime_error("bloom filter file is truncated");
+
+            detail::file_header header;
+            std::memcpy(&header, bytes, sizeof(header));
+            detail::check_header<hashing, hasher>(header, file.size());
+
+            std::vector<size_t> salts (header.num_salts);
+            for (size_t i = 0; i < salts.size(); ++i)
+            {
+                std::uint64_t salt;
+                std::memcpy(&salt, bytes + sizeof(header) + i * sizeof(salt), sizeof(salt));
+                salts[i] = salt;
+            }
+
+            // the mapping is read-only, which is fine because the filter is
+            // only ever used through const member functions
+            auto* words = reinterpret_cast<detail::bit_array::word_t*>(
+                    const_cast<char*>(bytes + header.data_offset));
+            return filter_t(
+                    detail::index_generator<T, hashing, hasher>(header.num_hash_functions, salts),
+                    detail::bit_array(words, header.num_bits));
+        }
+
+        /**
+         * The mapped file. Declared before the filter, which views it.
+         */
+        detail::mapped_file m_file;
+
+        /**
+         * The filter, whose bit array views the mapped file.
+         */
+        filter_t m_filter;
+};
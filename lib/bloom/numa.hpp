@@ -0,0 +1,155 @@
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#if defined(BLOOM_USE_LIBNUMA)
+#include <numa.h>
+#endif
+
+#pragma once
+
+namespace detail
+{
+    /**
+     * Discovery of the NUMA nodes of the machine and placement of threads
+     * on them. Memory is placed by first touch: pages are allocated on the
+     * node of the thread that first writes them, so storage that is
+     * allocated and cleared by a thread running on a node lives there.
+     *
+     * Nodes are read from sysfs on Linux. If the library is compiled with
+     * <code>BLOOM_USE_LIBNUMA</code> defined (and linked with
+     * <code>-lnuma</code>), threads are placed with libnuma, which also
+     * makes the node their preferred node for allocations, so placement
+     * does not depend on first touch alone. Elsewhere, the machine is a
+     * single node and placement does nothing.
+     */
+    namespace numa
+    {
+        /**
+         * A NUMA node and the CPUs it contains.
+         */
+        struct node
+        {
+            int id;
+            std::vector<int> cpus;
+        };
+
+        /**
+         * Parse a list of CPUs or nodes in the kernel's list format, e.g.
+         * <code>0-3,8,10-11</code>.
+         *
+         * \param list  List to parse
+         * \return      Numbers in the list, in order
+         */
+        inline std::vector<int> parse_list(std::string const& list)
+        {
+            std::vector<int> numbers;
+            std::istringstream in (list);
+            std::string range;
+            while (std::getline(in, range, ','))
+            {
+                if (range.empty() or range == "\n") continue;
+                size_t const dash = range.find('-');
+                int const first = std::stoi(range.substr(0, dash));
+                int const last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+                for (int n = first; n <= last; ++n) numbers.push_back(n);
+            }
+            return numbers;
+        }
+
+        /**
+         * \param path  Path of a sysfs file holding a list
+         * \return      Numbers in the list, empty if the file can not be
+         *              read
+         */
+        inline std::vector<int> read_list(std::string const& path)
+        {
+            std::ifstream file (path);
+            std::string list;
+            if (not std::getline(file, list)) return {};
+            return parse_list(list);
+        }
+
+        /**
+         * The NUMA nodes that have CPUs, in order of their ids. Read once.
+         *
+         * \return      Nodes, at least one. Without NUMA support a single
+         *              node 0 with an empty CPU list, which stands for any
+         *              CPU.
+         */
+        inline std::vector<node> const& nodes()
+        {
+            static std::vector<node> const all = []
+            {
+                std::vector<node> found;
+#if defined(__linux__)
+                std::string const root = "/sys/devices/system/node/";
+                for (int const id : read_list(root + "online"))
+                {
+                    auto cpus = read_list(root + "node" + std::to_string(id) + "/cpulist");
+                    if (not cpus.empty()) found.push_back({ id, std::move(cpus) });
+                }
+#endif
+                if (found.empty()) found.push_back({ 0, {} });
+                return found;
+            }();
+            return all;
+        }
+
+        /**
+         * Restrict the calling thread to the CPUs of a node.
+         *
+         * \param n     Node
+         */
+        inline void run_on(node const& n)
+        {
+#if defined(BLOOM_USE_LIBNUMA)
+            if (numa_available() >= 0)
+            {
+                numa_run_on_node(n.id);
+                numa_set_preferred(n.id);
+                return;
+            }
+#endif
+#if defined(__linux__)
+            if (n.cpus.empty()) return;
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (int const cpu : n.cpus)
+            {
+                if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+            }
+            // best effort, e.g. a cgroup may forbid some of the CPUs
+            sched_setaffinity(0, sizeof(set), &set);
+#else
+            (void) n;
+#endif
+        }
+
+        /**
+         * Run a function on a new thread placed on a node. The calling
+         * thread keeps its placement.
+         *
+         * \param n     Node
+         * \param f     Function to run
+         * \return      Thread running the function
+         */
+        template<typename function_t>
+        std::thread start_on(node const& n, function_t f)
+        {
+            return std::thread([n, f = std::move(f)]
+            {
+                run_on(n);
+                f();
+            });
+        }
+    } // namespace numa
+} // namespace detail
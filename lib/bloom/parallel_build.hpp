@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bit_array.hpp"
+
+#pragma once
+
+namespace detail
+{
+    /**
+     * Reusable barrier for a fixed number of threads, the part of C++20's
+     * <code>std::barrier</code> that is needed here.
+     */
+    class barrier
+    {
+        public:
+            /**
+             * Constructor.
+             *
+             * \param num_threads   Number of threads that wait at the barrier
+             */
+            explicit barrier(size_t const num_threads)
+            :   m_num_threads(num_threads),
+                m_waiting(0),
+                m_generation(0)
+            {
+                // ctor
+            }
+
+            /**
+             * Block until all threads have arrived.
+             */
+            void arrive_and_wait()
+            {
+                std::unique_lock<std::mutex> lock (m_mutex);
+                size_t const generation = m_generation;
+                if (++m_waiting == m_num_threads)
+                {
+                    m_waiting = 0;
+                    ++m_generation;
+                    m_all_arrived.notify_all();
+                    return;
+                }
+                m_all_arrived.wait(lock, [&] { return m_generation != generation; });
+            }
+
+        private:
+            std::mutex m_mutex;
+            std::condition_variable m_all_arrived;
+            size_t const m_num_threads;
+            size_t m_waiting;
+            size_t m_generation;
+    }; // class barrier
+
+    /**
+     * First exception thrown by the threads of an operation that proceeds
+     * in rounds separated by barriers. A thread that throws still arrives
+     * at the barrier, and after it all threads see the failure and stop in
+     * the same round, so none is left waiting for the others. The caller
+     * rethrows the exception after joining them.
+     */
+    class round_errors
+    {
+        public:
+            /**
+             * Record the exception being handled, unless another thread
+             * recorded one before.
+             */
+            void capture()
+            {
+                std::lock_guard<std::mutex> lock (m_mutex);
+                if (not m_error) m_error = std::current_exception();
+                m_failed.store(true, std::memory_order_relaxed);
+            }
+
+            /**
+             * Only consistent across threads right after a barrier that
+             * follows all calls of <code>capture</code> of the round.
+             *
+             * \return      Whether a thread threw
+             */
+            bool failed() const { return m_failed.load(std::memory_order_relaxed); }
+
+            /**
+             * Rethrow the recorded exception, if any.
+             */
+            void rethrow() const
+            {
+                if (m_error) std::rethrow_exception(m_error);
+            }
+
+        private:
+            std::mutex m_mutex;
+            std::atomic<bool> m_failed { false };
+            std::exception_ptr m_error;
+    }; // class round_errors
+
+    /**
+     * Number of threads to use when the caller asks for 0.
+     *
+     * \return      Number of hardware threads, at least 1
+     */
+    inline size_t default_num_threads()
+    {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    /**
+     * Set the bits of a range of values in parallel, without copies of the
+     * bit array and without atomic operations.
+     *
+     * The bit array is split into one word-aligned partition per thread,
+     * and every thread hashes a slice of the values. The work proceeds in
+     * rounds: each thread hashes the next <code>round_values</code> values
+     * of its slice and sorts their indices into one buffer per partition;
+     * after a barrier, each thread sets the bits its partition received
+     * from all threads. Only the owner of a word ever writes it, and each
+     * thread's writes stay within 1/num_threads of the array, which also
+     * helps the caches.
+     *
+     * If a thread throws while hashing, e.g. from the hasher or because a
+     * buffer can not grow, all threads stop after the round and the first
+     * exception is rethrown; the bits of earlier rounds stay set.
+     *
+     * \param first         Iterator to the first value
+     * \param last          Iterator past the last value
+     * \param num_threads   Number of threads, including the calling one
+     * \param bits          Bit array to set the bits in
+     * \param indices       Function <code>(value, size_t* out)</code>
+     *                      writing the <code>k</code> indices of a value
+     * \param k             Number of indices per value
+     */
+    template<typename iterator_t, typename indices_fn>
+    void parallel_build(iterator_t first, iterator_t const last, size_t const num_threads,
+            bit_array& bits, indices_fn const& indices, size_t const k)
+    {
+        constexpr size_t const round_values = 1 << 14;
+
+        size_t const n = static_cast<size_t>(std::distance(first, last));
+        size_t const words_per_partition = (bits.num_words() + num_threads - 1) / num_threads;
+        size_t const slice = (n + num_threads - 1) / num_threads;
+        size_t const rounds = (slice + round_values - 1) / round_values;
+
+        // buffers[t][p] holds the indices thread t found for partition p
+        std::vector<std::vector<std::vector<size_t>>> buffers (num_threads,
+                std::vector<std::vector<size_t>>(num_threads));
+        barrier sync (num_threads);
+        round_errors errors;
+
+        auto const work = [&](size_t const t, iterator_t it, size_t const count)
+        {
+            std::vector<size_t> value_indices;
+            auto& own = buffers[t];
+            for (size_t round = 0; round < rounds; ++round)
+            {
+                try
+                {
+                    value_indices.resize(k);
+                    for (auto& buffer : own) buffer.clear();
+                    size_t const begin = std::min(count, round * round_values);
+                    size_t const end = std::min(count, begin + round_values);
+                    for (size_t v = begin; v < end; ++v, ++it)
+                    {
+                        indices(*it, value_indices.data());
+                        for (size_t const idx : value_indices)
+                        {
+                            own[idx / bit_array::word_bits / words_per_partition].push_back(idx);
+                        }
+                    }
+                }
+                catch (...) { errors.capture(); }
+
+                sync.arrive_and_wait();
+                if (errors.failed()) return;
+                for (auto const& from : buffers)
+                {
+                    for (size_t const idx : from[t]) bits.set(idx);
+                }
+                sync.arrive_and_wait();
+            }
+        };
+
+        // the calling thread takes the first slice
+        iterator_t const own_first = first;
+        size_t const own_count = std::min(slice, n);
+        std::advance(first, own_count);
+
+        std::vector<std::thread> workers;
+        size_t begin = own_count;
+        for (size_t t = 1; t < num_threads; ++t)
+        {
+            size_t const count = std::min(slice, n - begin);
+            workers.emplace_back(work, t, first, count);
+            std::advance(first, count);
+            begin += count;
+        }
+        work(0, own_first, own_count);
+        for (auto& worker : workers) worker.join();
+        errors.rethrow();
+    }
+} // namespace detail
@@ -0,0 +1,132 @@
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+
+#pragma once
+
+namespace detail
+{
+    constexpr double const ln2 = 0.693147180559945309417;
+
+    /**
+     * Natural logarithm that can be evaluated at compile time, which
+     * <code>std::log</code> can not before C++26. Accurate to a few ulp.
+     *
+     * \param x     Argument, greater than zero
+     * \return      ln(x)
+     */
+    constexpr double constexpr_log(double x)
+    {
+        // reduce to [ 1, 2 ), then ln(x) = 2 atanh((x - 1) / (x + 1))
+        int exponent = 0;
+        while (x >= 2) { x /= 2; ++exponent; }
+        while (x < 1) { x *= 2; --exponent; }
+
+        double const y = (x - 1) / (x + 1);
+        double const y2 = y * y;
+        double term = y;
+        double sum = 0;
+        for (int i = 1; i < 60; i += 2)
+        {
+            sum += term / i;
+            term *= y2;
+        }
+        return 2 * sum + exponent * ln2;
+    }
+
+    /**
+     * Exponential function that can be evaluated at compile time.
+     *
+     * \param x     Argument
+     * \return      e^x
+     */
+    constexpr double constexpr_exp(double const x)
+    {
+        // e^x = 2^n e^r with |r| <= ln(2) / 2
+        long const n = static_cast<long>(x / ln2 + (x < 0 ? -0.5 : 0.5));
+        double const r = x - n * ln2;
+
+        double term = 1;
+        double sum = 1;
+        for (int i = 1; i < 25; ++i)
+        {
+            term *= r / i;
+            sum += term;
+        }
+        for (long i = 0; i < n; ++i) sum *= 2;
+        for (long i = 0; i > n; --i) sum /= 2;
+        return sum;
+    }
+
+    /**
+     * Smallest number of bits for which a bloom filter with k hash functions
+     * over n values has a false positive rate of at most p, from
+     *      p = (1 - e^(-k n / m))^k
+     *
+     * \param n     Number of values
+     * \param p     False positive rate
+     * \param k     Number of hash functions
+     * \return      Number of bits
+     */
+    constexpr double bits_for(double const n, double const p, double const k)
+    {
+        return -k * n / constexpr_log(1 - constexpr_exp(constexpr_log(p) / k));
+    }
+} // namespace detail
+
+/**
+ * Size of a bloom filter: its number of bits and hash functions.
+ */
+struct bloom_parameters
+{
+    size_t num_bits;
+    size_t num_hash_functions;
+};
+
+/**
+ * Compute the smallest bloom filter that holds a number of values with at
+ * most a given false positive rate. The number of bits is exact, not rounded
+ * to a power of two, so the result is meant for a
+ * <code>dynamic_bloom_filter</code> or a <code>sized_bloom_filter</code>.
+ *
+ * The textbook optimum of m = -n ln(p) / ln(2)^2 bits and k = -log2(p) hash
+ * functions assumes a fractional k. This function instead tries the integers
+ * around the optimal k and picks the one needing the fewest bits.
+ *
+ * This can be evaluated at compile time:
+ * \code
+ *      constexpr auto params = optimal_parameters(1000000, 0.01);
+ *      sized_bloom_filter<int, params.num_bits, params.num_hash_functions> filter;
+ * \endcode
+ * and equally at runtime:
+ * \code
+ *      dynamic_bloom_filter<int> filter (optimal_parameters(n, p));
+ * \endcode
+ *
+ * \param expected_values   Number of values that will be added
+ * \param fpr               Target false positive rate, in ( 0, 1 )
+ * \return                  Number of bits and hash functions
+ * \throw std::invalid_argument if the arguments are out of range
+ */
+constexpr bloom_parameters optimal_parameters(size_t const expected_values, double const fpr)
+{
+    if (expected_values == 0)
+        throw std::invalid_argument("expected number of values must be positive");
+    if (not (fpr > 0 and fpr < 1))
+        throw std::invalid_argument("false positive rate must be in (0, 1)");
+
+    double const n = static_cast<double>(expected_values);
+    double const k_optimal = -detail::constexpr_log(fpr) / detail::ln2;
+
+    bloom_parameters best { std::numeric_limits<size_t>::max(), 0 };
+    size_t const k_low = k_optimal < 2 ? 1 : static_cast<size_t>(k_optimal) - 1;
+    for (size_t k = k_low; k <= static_cast<size_t>(k_optimal) + 2; ++k)
+    {
+        double const bits = detail::bits_for(n, fpr, static_cast<double>(k));
+        // round up, so the target is met
+        size_t num_bits = static_cast<size_t>(bits);
+        if (static_cast<double>(num_bits) < bits) ++num_bits;
+        if (num_bits < best.num_bits) best = { num_bits, k };
+    }
+    return best;
+}
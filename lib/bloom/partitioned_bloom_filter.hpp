@@ -0,0 +1,429 @@
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "bit_array.hpp"
+#include "index_generator.hpp"
+#include "numa.hpp"
+#include "parallel_build.hpp"
+
+#pragma once
+
+/**
+ * Bloom filter whose bits are split into shards that live on the NUMA nodes
+ * of the machine. A value belongs to one shard, chosen by the high bits of
+ * an extra hash, and all its bits are set in that shard, which is a bloom
+ * filter of its own. With as many values per bit in every shard, the false
+ * positive rate is that of a <code>dynamic_bloom_filter</code> with the
+ * same parameters.
+ *
+ * The shards are spread evenly over the NUMA nodes that have CPUs. Each one
+ * is allocated and cleared by a thread running on its node, so that its
+ * pages are placed there by first touch (and with libnuma also by policy,
+ * see <code>detail::numa</code>). <code>build</code> and a
+ * <code>test_batch</code> with several threads route every value to a
+ * thread on the node of its shard, so the memory accesses stay local and
+ * the throughput grows with the number of memory controllers instead of
+ * being capped by one. On a machine with a single node, the shards still
+ * split <code>build</code> among the threads.
+ *
+ * Thread safety: as for <code>dynamic_bloom_filter</code>, any number of
+ * threads may call the const members concurrently.
+ *
+ * Filters can be moved but not copied, as a copy would not keep the
+ * placement.
+ *
+ * \param T         Template parameter for the type to build the filter for.
+ * \param hashing   Hashing scheme, <code>independent_hashing</code> or
+ *                  <code>double_hashing</code>.
+ * \param hasher    Hasher, e.g. <code>wyhash_hasher</code> or
+ *                  <code>std_hasher</code>.
+ */
+template<typename T, typename hashing = independent_hashing,
+    typename hasher = wyhash_hasher>
+class partitioned_bloom_filter
+{
+    public:
+        /**
+         * Number of values whose words are prefetched ahead while routed
+         * values are processed.
+         */
+        static constexpr size_t const batch_window = 8;
+
+        /**
+         * Number of values every thread routes per round in
+         * <code>build</code> and <code>test_batch</code>.
+         */
+        static constexpr size_t const round_values = 1 << 14;
+
+        /**
+         * Constructor. Derives the salt values of all hash functions from the
+         * default seed.
+         *
+         * \param num_bits              Number of bits in the filter, rounded
+         *                              up to a multiple of the number of
+         *                              shards
+         * \param num_hash_functions    Number of hash functions to use
+         * \param num_shards            Number of shards; 0 for one per
+         *                              hardware thread, but at least one
+         *                              per NUMA node
+         * \param huge_pages            Whether to try to back the shards
+         *                              with huge pages
+         */
+        partitioned_bloom_filter(size_t const num_bits,
+                size_t const num_hash_functions,
+                size_t const num_shards = 0,
+                bool const huge_pages = false)
+        :   partitioned_bloom_filter(num_bits, num_hash_functions, num_shards,
+                    filter_seed{detail::default_seed}, huge_pages)
+        {
+            // ctor
+        };
+
+        /**
+         * Constructor. Derives the salt values of all hash functions from a
+         * seed.
+         *
+         * \param num_bits              Number of bits in the filter
+         * \param num_hash_functions    Number of hash functions to use
+         * \param num_shards            Number of shards, see above
+         * \param seed                  Seed of the salt values
+         * \param huge_pages            Whether to try to back the shards
+         *                              with huge pages
+         */
+        partitioned_bloom_filter(size_t const num_bits,
+                size_t const num_hash_functions,
+                size_t num_shards,
+                filter_seed const seed,
+                bool const huge_pages = false)
+        :   m_indices(num_hash_functions + 1, seed.value)
+        {
+            if (num_bits == 0)
+                throw std::invalid_argument("bloom filter needs at least one bit");
+            if (num_hash_functions == 0)
+                throw std::invalid_argument("bloom filter needs at least one hash function");
+
+            size_t const num_nodes = detail::numa::nodes().size();
+            if (num_shards == 0)
+            {
+                num_shards = std::max(num_nodes, detail::default_num_threads());
+                num_shards = (num_shards + num_nodes - 1) / num_nodes * num_nodes;
+            }
+            m_shard_bits = (num_bits + num_shards - 1) / num_shards;
+            m_shards.resize(num_shards);
+            place(huge_pages);
+        };
+
+        partitioned_bloom_filter(partitioned_bloom_filter&&) = default;
+        partitioned_bloom_filter& operator= (partitioned_bloom_filter&&) = default;
+
+        /**
+         * Destructor.
+         */
+        ~partitioned_bloom_filter() = default;
+
+        /**
+         * Add a value to the filter.
+         *
+         * \param t     Value to add
+         */
+        void add(T const& t)
+        {
+            auto const hashed = m_indices.hash(t);
+            auto& bits = m_shards[hashed.index(0, m_shards.size())];
+            for (size_t i = 1; i < m_indices.size(); ++i)
+            {
+                bits.set(hashed.index(i, m_shard_bits));
+            }
+        };
+
+        /**
+         * Test whether a value is in the filter, see
+         * <code>dynamic_bloom_filter::test</code>.
+         *
+         * \param t     Data item to check for
+         * \return      Boolean value indicating membership
+         */
+        bool test(T const& t) const
+        {
+            auto const hashed = m_indices.hash(t);
+            auto const& bits = m_shards[hashed.index(0, m_shards.size())];
+            for (size_t i = 1; i < m_indices.size(); ++i)
+            {
+                if (not bits.test(hashed.index(i, m_shard_bits)))
+                    return false;
+            }
+            return true;
+        };
+
+        /**
+         * Add all values of a range. Every thread hashes a slice of the
+         * values and routes them to the threads that own their shards,
+         * which run on the shards' nodes and are the only ones to write
+         * them. This has the same effect as calling <code>add</code> for
+         * every value.
+         *
+         * Do not call other members of the filter while this runs.
+         *
+         * \param first         Iterator to the first value
+         * \param last          Iterator past the last value
+         * \param num_threads   Number of threads to use, at most one per
+         *                      shard; 0 for one per shard
+         */
+        template<typename iterator_t>
+        void build(iterator_t const first, iterator_t const last, size_t const num_threads = 0)
+        {
+            route(first, static_cast<size_t>(std::distance(first, last)),
+                    num_threads == 0 ? m_shards.size() : num_threads, true,
+                    [this](size_t const shard, size_t const* entry)
+                    {
+                        for (size_t i = 1; i < m_indices.size(); ++i)
+                        {
+                            m_shards[shard].set(entry[i]);
+                        }
+                    });
+        };
+
+        /**
+         * Test several values for membership. The values are grouped by
+         * shard and the words of <code>batch_window</code> values are
+         * prefetched ahead, so the cache misses overlap. With several
+         * threads, each tests the values of the shards on its node.
+         *
+         * \param values        Pointer to the first value
+         * \param count         Number of values
+         * \param results       Bitmap of at least <code>(count + 63) /
+         *                      64</code> words, see
+         *                      <code>dynamic_bloom_filter::test_batch</code>
+         * \param num_threads   Number of threads to use, at most one per
+         *                      shard. With 1 the calling thread tests all
+         *                      values.
+         */
+        void test_batch(T const* values, size_t const count, std::uint64_t* results,
+                size_t const num_threads = 1) const
+        {
+            std::vector<std::uint8_t> members (count);
+            route(values, count, num_threads, false,
+                    [this, &members](size_t const shard, size_t const* entry)
+                    {
+                        auto const& bits = m_shards[shard];
+                        bool member = true;
+                        for (size_t i = 1; i < m_indices.size() and member; ++i)
+                        {
+                            member = bits.test(entry[i]);
+                        }
+                        members[entry[0]] = member;
+                    });
+
+            std::fill(results, results + (count + 63) / 64, 0);
+            for (size_t v = 0; v < count; ++v)
+            {
+                results[v / 64] |= std::uint64_t{members[v]} << (v % 64);
+            }
+        };
+
+        /**
+         * \return      Number of bits in the filter, over all shards
+         */
+        size_t num_bits() const { return m_shard_bits * m_shards.size(); }
+
+        /**
+         * \return      Number of hash functions used per value
+         */
+        size_t num_hash_functions() const { return m_indices.size() - 1; }
+
+        /**
+         * \return      Number of shards
+         */
+        size_t num_shards() const { return m_shards.size(); }
+
+        /**
+         * \param shard     Number of a shard
+         * \return          Id of the NUMA node the shard was placed on
+         */
+        int shard_node(size_t const shard) const
+        {
+            return detail::numa::nodes()[node_of(shard)].id;
+        }
+
+    private:
+        /**
+         * \param shard     Number of a shard
+         * \return          Position of its node in
+         *                  <code>detail::numa::nodes()</code>. The shards
+         *                  of a node are adjacent.
+         */
+        size_t node_of(size_t const shard) const
+        {
+            return shard * detail::numa::nodes().size() / m_shards.size();
+        }
+
+        /**
+         * Allocate and clear every shard on a thread running on its node.
+         *
+         * \param huge_pages    Whether to try to back the shards with huge
+         *                      pages
+         */
+        void place(bool const huge_pages)
+        {
+            auto const allocate = [this, huge_pages](size_t const node)
+            {
+                for (size_t s = 0; s < m_shards.size(); ++s)
+                {
+                    if (node_of(s) != node) continue;
+                    m_shards[s] = detail::bit_array(m_shard_bits, huge_pages);
+                    // mapped huge pages are only touched when written
+                    if (huge_pages) m_shards[s].reset();
+                }
+            };
+
+            auto const& nodes = detail::numa::nodes();
+            if (nodes.size() == 1)
+            {
+                allocate(0);
+                return;
+            }
+
+            std::vector<std::exception_ptr> errors (nodes.size());
+            std::vector<std::thread> threads;
+            for (size_t n = 0; n < nodes.size(); ++n)
+            {
+                threads.push_back(detail::numa::start_on(nodes[n], [&allocate, &errors, n]
+                {
+                    try { allocate(n); }
+                    catch (...) { errors[n] = std::current_exception(); }
+                }));
+            }
+            for (auto& thread : threads) thread.join();
+            for (auto const& error : errors)
+            {
+                if (error) std::rethrow_exception(error);
+            }
+        }
+
+        /**
+         * Route values to the threads that own their shards, in rounds as
+         * <code>detail::parallel_build</code>: each thread hashes the next
+         * <code>round_values</code> values of its slice into one buffer per
+         * shard; after a barrier, each thread processes the entries of its
+         * shards from all threads, with the words of the entries
+         * <code>batch_window</code> ahead prefetched. Thread t owns a
+         * contiguous block of shards and runs on the node of the first;
+         * a single thread is the calling one and is not moved. The first
+         * exception of any thread stops all of them after the round and is
+         * rethrown, see <code>detail::round_errors</code>.
+         *
+         * \param first         Iterator to the first value
+         * \param count         Number of values
+         * \param num_threads   Number of threads
+         * \param write         Whether the entries will write their words
+         * \param process       Function <code>(shard, entry)</code>; an
+         *                      entry is the position of the value followed
+         *                      by its indices 1 to k in the shard
+         */
+        template<typename iterator_t, typename process_fn>
+        void route(iterator_t first, size_t const count, size_t num_threads,
+                bool const write, process_fn const& process) const
+        {
+            size_t const num_shards = m_shards.size();
+            size_t const stride = m_indices.size();
+            num_threads = std::max<size_t>(1, std::min(num_threads, num_shards));
+            size_t const slice = (count + num_threads - 1) / num_threads;
+            size_t const rounds = (slice + round_values - 1) / round_values;
+
+            // buffers[t][s] holds the entries thread t found for shard s
+            std::vector<std::vector<std::vector<size_t>>> buffers (num_threads,
+                    std::vector<std::vector<size_t>>(num_shards));
+            detail::barrier sync (num_threads);
+            detail::round_errors errors;
+
+            auto const work = [&](size_t const t, iterator_t it, size_t const begin, size_t const n)
+            {
+                auto& own = buffers[t];
+                for (size_t round = 0; round < rounds; ++round)
+                {
+                    try
+                    {
+                        for (auto& buffer : own) buffer.clear();
+                        size_t const round_begin = std::min(n, round * round_values);
+                        size_t const round_end = std::min(n, round_begin + round_values);
+                        for (size_t v = round_begin; v < round_end; ++v, ++it)
+                        {
+                            auto const& value = *it;
+                            auto const hashed = m_indices.hash(value);
+                            auto& buffer = own[hashed.index(0, num_shards)];
+                            buffer.push_back(begin + v);
+                            for (size_t i = 1; i < stride; ++i)
+                            {
+                                buffer.push_back(hashed.index(i, m_shard_bits));
+                            }
+                        }
+                    }
+                    catch (...) { errors.capture(); }
+
+                    sync.arrive_and_wait();
+                    if (errors.failed()) return;
+                    for (size_t s = t * num_shards / num_threads; s < (t + 1) * num_shards / num_threads; ++s)
+                    {
+                        auto const& bits = m_shards[s];
+                        for (auto const& from : buffers)
+                        {
+                            auto const& entries = from[s];
+                            for (size_t e = 0; e < entries.size(); e += stride)
+                            {
+                                size_t const ahead = e + batch_window * stride;
+                                for (size_t i = 1; ahead < entries.size() and i < stride; ++i)
+                                {
+                                    if (write) bits.prefetch_write(entries[ahead + i]);
+                                    else bits.prefetch_read(entries[ahead + i]);
+                                }
+                                process(s, entries.data() + e);
+                            }
+                        }
+                    }
+                    sync.arrive_and_wait();
+                }
+            };
+
+            if (num_threads == 1)
+            {
+                work(0, first, 0, count);
+                errors.rethrow();
+                return;
+            }
+
+            auto const& nodes = detail::numa::nodes();
+            std::vector<std::thread> threads;
+            size_t begin = 0;
+            for (size_t t = 0; t < num_threads; ++t)
+            {
+                size_t const n = std::min(slice, count - begin);
+                threads.push_back(detail::numa::start_on(nodes[node_of(t * num_shards / num_threads)],
+                        [&work, t, first, begin, n] { work(t, first, begin, n); }));
+                std::advance(first, n);
+                begin += n;
+            }
+            for (auto& thread : threads) thread.join();
+            errors.rethrow();
+        }
+
+        /**
+         * Computes the shard and the indices of a value: index 0 picks the
+         * shard, indices 1 to k are the bits in it.
+         */
+        detail::index_generator<T, hashing, hasher> m_indices;
+
+        /**
+         * Number of bits in every shard.
+         */
+        size_t m_shard_bits;
+
+        /**
+         * The shards, in the order of their nodes.
+         */
+        std::vector<detail::bit_array> m_shards;
+};
@@ -0,0 +1,284 @@
+#include <cstdint>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#pragma once
+
+namespace detail
+{
+    /**
+     * Probe kernels of <code>simd_blocked_bloom_filter</code>. All kernels
+     * compute exactly the same function, so a filter built by one can be
+     * queried by any other; they only differ in how many keys they process
+     * per instruction.
+     *
+     * The filter consists of blocks of 8 32-bit words. A 64-bit key is mixed
+     * into a 64-bit hash. The high half of the hash selects the block, and
+     * the low half <code>x</code> sets one bit in each word of the block: bit
+     * <code>(x * salts[i]) >> 27</code> of word <code>i</code>. This is the
+     * layout of the split block bloom filter used by Apache Parquet and
+     * Impala.
+     */
+    namespace probe
+    {
+        /**
+         * Number of 32-bit words in a block, and thus bits set per key.
+         */
+        constexpr size_t const block_words = 8;
+
+        /**
+         * Odd multipliers that derive the bit in each word of a block.
+         */
+        constexpr std::uint32_t const salts[block_words] = {
+            0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+            0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u
+        };
+
+        /**
+         * Multipliers of the key mixing function.
+         */
+        constexpr std::uint64_t const mix_multiplier_1 = 0x9e3779b97f4a7c15ull;
+        constexpr std::uint64_t const mix_multiplier_2 = 0xd6e8feb86659fd93ull;
+
+        /**
+         * Mix a key into a 64-bit hash. This only uses operations that exist
+         * on 64-bit vector lanes, so the vector kernels compute the same.
+         *
+         * \param key   Key
+         * \param seed  Seed of the filter
+         * \return      Hash value
+         */
+        inline std::uint64_t hash_key(std::uint64_t const key, std::uint64_t const seed)
+        {
+            std::uint64_t h = (key ^ seed) * mix_multiplier_1;
+            h ^= h >> 32;
+            h *= mix_multiplier_2;
+            h ^= h >> 32;
+            return h;
+        }
+
+        /**
+         * \param hash          Hash of a key
+         * \param num_blocks    Number of blocks, less than 2^32
+         * \return              Block of the key
+         */
+        inline std::uint64_t block_of(std::uint64_t const hash, std::uint64_t const num_blocks)
+        {
+            return ((hash >> 32) * num_blocks) >> 32;
+        }
+
+        /**
+         * \param hash  Hash of a key
+         * \param i     Word of the block
+         * \return      Mask of the bit of the key in word i of its block
+         */
+        inline std::uint32_t bit_of(std::uint64_t const hash, size_t const i)
+        {
+            return std::uint32_t{1} << ((static_cast<std::uint32_t>(hash) * salts[i]) >> 27);
+        }
+
+        /**
+         * Add one key.
+         *
+         * \param words         Words of the filter
+         * \param num_blocks    Number of blocks
+         * \param seed          Seed of the filter
+         * \param key           Key to add
+         */
+        inline void add(std::uint32_t* words, std::uint64_t const num_blocks,
+                std::uint64_t const seed, std::uint64_t const key)
+        {
+            auto const hash = hash_key(key, seed);
+            std::uint32_t* block = words + block_of(hash, num_blocks) * block_words;
+            for (size_t i = 0; i < block_words; ++i)
+            {
+                block[i] |= bit_of(hash, i);
+            }
+        }
+
+        /**
+         * Test one key.
+         *
+         * \param words         Words of the filter
+         * \param num_blocks    Number of blocks
+         * \param seed          Seed of the filter
+         * \param key           Key to test
+         * \return              Whether the key may be in the filter
+         */
+        inline bool test(std::uint32_t const* words, std::uint64_t const num_blocks,
+                std::uint64_t const seed, std::uint64_t const key)
+        {
+            auto const hash = hash_key(key, seed);
+            std::uint32_t const* block = words + block_of(hash, num_blocks) * block_words;
+            std::uint32_t missing = 0;
+            for (size_t i = 0; i < block_words; ++i)
+            {
+                auto const bit = bit_of(hash, i);
+                missing |= bit & ~block[i];
+            }
+            return missing == 0;
+        }
+
+        /**
+         * Signature of the batch test kernels. Bit <code>j % 64</code> of
+         * <code>results[j / 64]</code> is set if key j may be in the filter;
+         * the bitmap must be cleared by the caller.
+         */
+        using test_batch_fn = void (*)(std::uint32_t const* words,
+                std::uint64_t num_blocks, std::uint64_t seed,
+                std::uint64_t const* keys, size_t count, std::uint64_t* results);
+
+        /**
+         * Scalar batch test kernel, one key at a time.
+         */
+        inline void test_batch_scalar(std::uint32_t const* words,
+                std::uint64_t const num_blocks, std::uint64_t const seed,
+                std::uint64_t const* keys, size_t const count, std::uint64_t* results)
+        {
+            for (size_t j = 0; j < count; ++j)
+            {
+                results[j / 64] |= std::uint64_t{test(words, num_blocks, seed, keys[j])} << (j % 64);
+            }
+        }
+
+#if defined(__x86_64__)
+        /**
+         * Multiply 64-bit lanes, keeping the low 64 bits. AVX2 has no
+         * instruction for this, so it is composed of 32-bit multiplies.
+         */
+        __attribute__((target("avx2")))
+        inline __m256i mullo_epi64_avx2(__m256i const a, __m256i const b)
+        {
+            __m256i const lo = _mm256_mul_epu32(a, b);
+            __m256i const cross1 = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b);
+            __m256i const cross2 = _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32));
+            return _mm256_add_epi64(lo, _mm256_slli_epi64(_mm256_add_epi64(cross1, cross2), 32));
+        }
+
+        /**
+         * AVX2 batch test kernel. Hashes 4 keys per instruction and checks
+         * each word of their blocks with one gather.
+         */
+        __attribute__((target("avx2")))
+        inline void test_batch_avx2(std::uint32_t const* words,
+                std::uint64_t const num_blocks, std::uint64_t const seed,
+                std::uint64_t const* keys, size_t const count, std::uint64_t* results)
+        {
+            __m256i const vseed = _mm256_set1_epi64x(static_cast<long long>(seed));
+            __m256i const m1 = _mm256_set1_epi64x(static_cast<long long>(mix_multiplier_1));
+            __m256i const m2 = _mm256_set1_epi64x(static_cast<long long>(mix_multiplier_2));
+            __m256i const nb = _mm256_set1_epi64x(static_cast<long long>(num_blocks));
+            __m256i const low_halves = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+            __m128i const one = _mm_set1_epi32(1);
+            auto const* base = reinterpret_cast<int const*>(words);
+
+            size_t j = 0;
+            for (; j + 4 <= count; j += 4)
+            {
+                __m256i h = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(keys + j));
+                h = mullo_epi64_avx2(_mm256_xor_si256(h, vseed), m1);
+                h = _mm256_xor_si256(h, _mm256_srli_epi64(h, 32));
+                h = mullo_epi64_avx2(h, m2);
+                h = _mm256_xor_si256(h, _mm256_srli_epi64(h, 32));
+
+                __m256i const block = _mm256_srli_epi64(
+                        _mm256_mul_epu32(_mm256_srli_epi64(h, 32), nb), 32);
+                __m256i const first = _mm256_slli_epi64(block, 3);
+                __m128i const x = _mm256_castsi256_si128(
+                        _mm256_permutevar8x32_epi32(h, low_halves));
+
+                __m128i ok = _mm_set1_epi32(-1);
+                for (size_t i = 0; i < block_words; ++i)
+                {
+                    __m256i const idx = _mm256_add_epi64(first, _mm256_set1_epi64x(static_cast<long long>(i)));
+                    __m128i const word = _mm256_i64gather_epi32(base, idx, 4);
+                    __m128i const shift = _mm_srli_epi32(
+                            _mm_mullo_epi32(x, _mm_set1_epi32(static_cast<int>(salts[i]))), 27);
+                    __m128i const bit = _mm_sllv_epi32(one, shift);
+                    ok = _mm_and_si128(ok, _mm_cmpeq_epi32(_mm_and_si128(word, bit), bit));
+                }
+                auto const mask = static_cast<std::uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(ok)));
+                results[j / 64] |= mask << (j % 64);
+            }
+            for (; j < count; ++j)
+            {
+                results[j / 64] |= std::uint64_t{test(words, num_blocks, seed, keys[j])} << (j % 64);
+            }
+        }
+
+        // GCC reports the undefined pass-through operands of the AVX-512
+        // intrinsics as maybe uninitialized
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+        /**
+         * AVX-512 batch test kernel. Hashes 8 keys per instruction and checks
+         * each word of their blocks with one gather.
+         */
+        __attribute__((target("avx512f,avx512dq,avx512vl")))
+        inline void test_batch_avx512(std::uint32_t const* words,
+                std::uint64_t const num_blocks, std::uint64_t const seed,
+                std::uint64_t const* keys, size_t const count, std::uint64_t* results)
+        {
+            __m512i const vseed = _mm512_set1_epi64(static_cast<long long>(seed));
+            __m512i const m1 = _mm512_set1_epi64(static_cast<long long>(mix_multiplier_1));
+            __m512i const m2 = _mm512_set1_epi64(static_cast<long long>(mix_multiplier_2));
+            __m512i const nb = _mm512_set1_epi64(static_cast<long long>(num_blocks));
+            __m256i const one = _mm256_set1_epi32(1);
+
+            size_t j = 0;
+            for (; j + 8 <= count; j += 8)
+            {
+                __m512i h = _mm512_loadu_si512(keys + j);
+                h = _mm512_mullo_epi64(_mm512_xor_si512(h, vseed), m1);
+                h = _mm512_xor_si512(h, _mm512_srli_epi64(h, 32));
+                h = _mm512_mullo_epi64(h, m2);
+                h = _mm512_xor_si512(h, _mm512_srli_epi64(h, 32));
+
+                __m512i const block = _mm512_srli_epi64(
+                        _mm512_mul_epu32(_mm512_srli_epi64(h, 32), nb), 32);
+                __m512i const first = _mm512_slli_epi64(block, 3);
+                __m256i const x = _mm512_cvtepi64_epi32(h);
+
+                __mmask8 ok = 0xff;
+                for (size_t i = 0; i < block_words; ++i)
+                {
+                    __m512i const idx = _mm512_add_epi64(first, _mm512_set1_epi64(static_cast<long long>(i)));
+                    __m256i const word = _mm512_i64gather_epi32(idx, words, 4);
+                    __m256i const shift = _mm256_srli_epi32(
+                            _mm256_mullo_epi32(x, _mm256_set1_epi32(static_cast<int>(salts[i]))), 27);
+                    __m256i const bit = _mm256_sllv_epi32(one, shift);
+                    ok &= _mm256_cmpeq_epi32_mask(_mm256_and_si256(word, bit), bit);
+                }
+                results[j / 64] |= static_cast<std::uint64_t>(ok) << (j % 64);
+            }
+            for (; j < count; ++j)
+            {
+                results[j / 64] |= std::uint64_t{test(words, num_blocks, seed, keys[j])} << (j % 64);
+            }
+        }
+#pragma GCC diagnostic pop
+#endif
+
+        /**
+         * Pick the widest batch test kernel the CPU supports. The choice is
+         * made at runtime, so one binary runs on machines with and without
+         * AVX2 or AVX-512.
+         *
+         * \return      Batch test kernel
+         */
+        inline test_batch_fn select_test_batch()
+        {
+#if defined(__x86_64__)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f") and __builtin_cpu_supports("avx512dq")
+                    and __builtin_cpu_supports("avx512vl"))
+                return test_batch_avx512;
+            if (__builtin_cpu_supports("avx2"))
+                return test_batch_avx2;
+#endif
+            return test_batch_scalar;
+        }
+    } // namespace probe
+} // namespace detail
@@ -1,6 +1,25 @@
 #include <cstdint>
 #include <unordered_set>
 
+#pragma once
+
+namespace detail
+{
+    /**
+     * Combine the <code>std::hash</code> of a value with a salt, exactly as
+     * <code>std::hash<salted_type<T>></code> does, but without copying the
+     * value into a <code>salted_type</code>.
+     *
+     * \param hash      Hash of the value
+     * \param salt      Salt value
+     * \return          Salted hash
+     */
+    inline std::size_t salt_hash(std::size_t const hash, std::size_t const salt)
+    {
+        return std::hash<std::size_t>{}(hash ^ salt);
+    }
+} // namespace detail
+
 /**
  * Simple type to be used for hashing with a salt value.
  */
@@ -23,9 +42,7 @@ namespace std
         result_type
         operator()(argument_type const& arg) const noexcept
         {
-            result_type saltable = std::hash<T>{}(arg.value);
-            saltable ^= arg.salt;
-            return std::hash<result_type>{}(saltable);
+            return detail::salt_hash(std::hash<T>{}(arg.value), arg.salt);
         }
     };
 }
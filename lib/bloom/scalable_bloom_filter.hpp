@@ -0,0 +1,212 @@
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "dynamic_bloom_filter.hpp"
+#include "index_generator.hpp"
+#include "parameters.hpp"
+
+#pragma once
+
+/**
+ * Bloom filter that grows as values are added, so it does not need to be
+ * sized for the largest possible number of values (Almeida et al.,
+ * "Scalable Bloom Filters"). It is a chain of <code>dynamic_bloom_filter</code>
+ * stages. Values are added to the newest stage until it holds as many values
+ * as it was sized for; then a new stage is appended.
+ *
+ * Stage i holds <code>initial_capacity * growth^i</code> values at a false
+ * positive rate of <code>fpr * (1 - tightening) * tightening^i</code>. The
+ * rates form a geometric series, so the expected false positive rate of the
+ * whole filter stays below <code>fpr</code> no matter how many stages are
+ * added, and the memory per value converges to a constant.
+ *
+ * A value is reported as a member if any stage reports it. Stages are
+ * tested newest first, because the newest stage holds most of the values.
+ *
+ * \param T         Template parameter for the type to build the filter for.
+ * \param hashing   Hashing scheme, <code>independent_hashing</code> or
+ *                  <code>double_hashing</code>.
+ * \param hasher    Hasher, e.g. <code>wyhash_hasher</code> or
+ *                  <code>std_hasher</code>.
+ */
+template<typename T, typename hashing = independent_hashing,
+    typename hasher = wyhash_hasher>
+class scalable_bloom_filter
+{
+    public:
+        /**
+         * Constructor. Allocates the first stage.
+         *
+         * \param initial_capacity  Number of values the first stage holds
+         * \param fpr               Bound on the false positive rate of the
+         *                          whole filter, in ( 0, 1 )
+         * \param growth            Factor by which the capacity grows from
+         *                          stage to stage, at least 1
+         * \param tightening        Factor by which the false positive rate
+         *                          shrinks from stage to stage, in ( 0, 1 )
+         */
+        scalable_bloom_filter(size_t const initial_capacity,
+                double const fpr,
+                double const growth = 2,
+                double const tightening = 0.5)
+        :   m_stages(),
+            m_capacities(),
+            m_stage_fprs(),
+            m_growth(growth),
+            m_tightening(tightening),
+            m_stage_size(0),
+            m_size(0)
+        {
+            if (initial_capacity == 0)
+                throw std::invalid_argument("capacity must be positive");
+            if (not (fpr > 0 and fpr < 1))
+                throw std::invalid_argument("false positive rate must be in (0, 1)");
+            if (not (growth >= 1))
+                throw std::invalid_argument("growth factor must be at least 1");
+            if (not (tightening > 0 and tightening < 1))
+                throw std::invalid_argument("tightening factor must be in (0, 1)");
+
+            add_stage(initial_capacity, fpr * (1 - tightening));
+        };
+
+        /**
+         * Destructor.
+         */
+        ~scalable_bloom_filter() = default;
+
+        /**
+         * Add a value to the filter, appending a stage first if the newest
+         * one is full.
+         *
+         * \param t     Value to add
+         * \throw std::length_error if the capacity of the next stage does
+         *              not fit a <code>size_t</code>
+         */
+        void add(T const& t)
+        {
+            if (m_stage_size == m_capacities.back())
+            {
+                double const capacity = m_capacities.back() * m_growth;
+                // converting a double beyond the range of size_t is undefined
+                if (not (capacity < static_cast<double>(std::numeric_limits<size_t>::max())))
+                    throw std::length_error("scalable bloom filter can not grow any further");
+                add_stage(static_cast<size_t>(capacity), m_stage_fprs.back() * m_tightening);
+            }
+            m_stages.back().add(t);
+            ++m_stage_size;
+            ++m_size;
+        };
+
+        /**
+         * Test whether a value is in the filter. The return value
+         * <code>false</code> means that the value is <i>guaranteed</i> not to
+         * be in the filter. The return value <code>true</code> means that the
+         * value <i>maybe</i> is in the set.
+         *
+         * \param t     Data item to check for
+         * \return      Boolean value indicating membership
+         */
+        bool test(T const& t) const
+        {
+            for (auto stage = m_stages.rbegin(); stage != m_stages.rend(); ++stage)
+            {
+                if (stage->test(t)) return true;
+            }
+            return false;
+        };
+
+        /**
+         * \return      Number of values added
+         */
+        size_t size() const { return m_size; }
+
+        /**
+         * \return      Number of values the filter holds before it appends
+         *              the next stage
+         */
+        size_t capacity() const
+        {
+            size_t capacity = 0;
+            for (auto const c : m_capacities) capacity += c;
+            return capacity;
+        }
+
+        /**
+         * \return      Number of stages
+         */
+        size_t num_stages() const { return m_stages.size(); }
+
+        /**
+         * \return      Number of bits in all stages
+         */
+        size_t num_bits() const
+        {
+            size_t num_bits = 0;
+            for (auto const& stage : m_stages) num_bits += stage.num_bits();
+            return num_bits;
+        }
+
+        /**
+         * \return      Bound on the false positive rate of the filter as it
+         *              is now, the sum of the rates of its stages
+         */
+        double fpr_bound() const
+        {
+            double fpr = 0;
+            for (auto const p : m_stage_fprs) fpr += p;
+            return fpr;
+        }
+
+    private:
+        /**
+         * Append an empty stage.
+         *
+         * \param capacity  Number of values the stage holds
+         * \param fpr       False positive rate of the stage when full
+         */
+        void add_stage(size_t const capacity, double const fpr)
+        {
+            m_stages.emplace_back(optimal_parameters(capacity, fpr));
+            m_capacities.push_back(capacity);
+            m_stage_fprs.push_back(fpr);
+            m_stage_size = 0;
+        }
+
+        /**
+         * The stages, oldest first.
+         */
+        std::vector<dynamic_bloom_filter<T, hashing, hasher>> m_stages;
+
+        /**
+         * Number of values each stage holds.
+         */
+        std::vector<size_t> m_capacities;
+
+        /**
+         * False positive rate of each stage when full.
+         */
+        std::vector<double> m_stage_fprs;
+
+        /**
+         * Factor by which the capacity grows from stage to stage.
+         */
+        double m_growth;
+
+        /**
+         * Factor by which the false positive rate shrinks from stage to
+         * stage.
+         */
+        double m_tightening;
+
+        /**
+         * Number of values in the newest stage.
+         */
+        size_t m_stage_size;
+
+        /**
+         * Number of values added.
+         */
+        size_t m_size;
+};
@@ -0,0 +1,436 @@
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "bit_array.hpp"
+#include "hashers.hpp"
+#include "index_generator.hpp"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#pragma once
+
+namespace detail
+{
+    /**
+     * Identifies a hashing scheme in saved filters.
+     */
+    template<typename hashing>
+    struct hashing_id;
+
+    template<>
+    struct hashing_id<independent_hashing>
+    {
+        static constexpr std::uint32_t const value = 1;
+    };
+
+    template<>
+    struct hashing_id<double_hashing>
+    {
+        static constexpr std::uint32_t const value = 2;
+    };
+
+    /**
+     * Number of salt values a filter saves for a hashing scheme: one per
+     * hash function for independent hashing, a single one for double
+     * hashing.
+     *
+     * \param num_hash_functions    Number of hash functions of the filter
+     * \return                      Number of salt values
+     */
+    template<typename hashing>
+    constexpr std::uint64_t expected_num_salts(std::uint64_t const num_hash_functions)
+    {
+        return std::is_same<hashing, double_hashing>::value ? 1 : num_hash_functions;
+    }
+
+    /**
+     * Identifies a hasher in saved filters, so a filter is never loaded with
+     * a hasher other than the one it was built with. User hashers get the
+     * id 0 unless they specialize this template.
+     */
+    template<typename hasher>
+    struct hasher_id
+    {
+        static constexpr std::uint32_t const value = 0;
+    };
+
+    template<>
+    struct hasher_id<std_hasher>
+    {
+        static constexpr std::uint32_t const value = 1;
+    };
+
+    template<>
+    struct hasher_id<wyhash_hasher>
+    {
+        static constexpr std::uint32_t const value = 2;
+    };
+
+    /**
+     * On-disk format of filters, version 1. A file consists of
+     *  - this header,
+     *  - <code>num_salts</code> 64-bit salt values, or for a binary fuse
+     *    filter its parameter words,
+     *  - zero padding up to <code>data_offset</code>, a multiple of the cache
+     *    line size,
+     *  - <code>data_size</code> bytes of filter data, for a bloom filter its
+     *    64-bit bit array words, for a binary fuse filter its fingerprints.
+     *
+     * All fields are in the byte order of the machine that wrote the file;
+     * a file from a machine of the other byte order is rejected because its
+     * magic number does not match. Because the data is aligned, a memory
+     * mapped file can be queried in place.
+     */
+    struct file_header
+    {
+        /**
+         * Magic number identifying the format, "BLOOMFLT".
+         */
+        static constexpr std::uint64_t const magic_value = 0x544c464d4f4f4c42ull;
+
+        /**
+         * Current version of the format.
+         */
+        static constexpr std::uint32_t const current_version = 1;
+
+        /**
+         * Kinds of filter data.
+         */
+        static constexpr std::uint32_t const kind_bloom = 1;
+        static constexpr std::uint32_t const kind_binary_fuse = 2;
+
+        std::uint64_t magic;
+        std::uint32_t version;
+        std::uint32_t kind;
+        std::uint32_t hashing;
+        std::uint32_t hasher;
+        std::uint64_t num_bits;
+        std::uint64_t num_hash_functions;
+        std::uint64_t num_salts;
+        std::uint64_t data_offset;
+        std::uint64_t data_size;
+    };
+
+    static_assert(sizeof(file_header) == 64, "File header must not have padding.");
+
+    /**
+     * Offset of the filter data in a file.
+     *
+     * \param num_salts     Number of salt values
+     * \return              Offset in bytes, a multiple of the cache line size
+     */
+    inline std::uint64_t data_offset(std::uint64_t const num_salts)
+    {
+        std::uint64_t const end = sizeof(file_header) + num_salts * sizeof(std::uint64_t);
+        return (end + cache_line_size - 1) / cache_line_size * cache_line_size;
+    }
+
+    /**
+     * Build the header of a filter.
+     *
+     * \param kind                  Kind of the filter data
+     * \param hashing               Id of the hashing scheme, or 0
+     * \param hasher                Id of the hasher
+     * \param num_bits              Number of bits of the filter
+     * \param num_hash_functions    Number of hash functions of the filter
+     * \param num_salts             Number of salt values
+     * \param data_size             Size of the filter data in bytes
+     * \return                      Header
+     */
+    inline file_header make_header(std::uint32_t const kind, std::uint32_t const hashing,
+            std::uint32_t const hasher, std::uint64_t const num_bits,
+            std::uint64_t const num_hash_functions, std::uint64_t const num_salts,
+            std::uint64_t const data_size)
+    {
+        file_header header {};
+        header.magic = file_header::magic_value;
+        header.version = file_header::current_version;
+        header.kind = kind;
+        header.hashing = hashing;
+        header.hasher = hasher;
+        header.num_bits = num_bits;
+        header.num_hash_functions = num_hash_functions;
+        header.num_salts = num_salts;
+        header.data_offset = data_offset(num_salts);
+        header.data_size = data_size;
+        return header;
+    }
+
+    /**
+     * Build the header of a bloom filter.
+     *
+     * \param num_bits              Number of bits of the filter
+     * \param num_hash_functions    Number of hash functions of the filter
+     * \param num_salts             Number of salt values
+     * \return                      Header
+     */
+    template<typename hashing, typename hasher>
+    file_header make_header(std::uint64_t const num_bits,
+            std::uint64_t const num_hash_functions, std::uint64_t const num_salts)
+    {
+        return make_header(file_header::kind_bloom, hashing_id<hashing>::value,
+                hasher_id<hasher>::value, num_bits, num_hash_functions, num_salts,
+                (num_bits + bit_array::word_bits - 1) / bit_array::word_bits
+                    * sizeof(bit_array::word_t));
+    }
+
+    /**
+     * Check that a header describes a filter that can be loaded as the
+     * expected kind, with the expected hashing scheme and hasher.
+     *
+     * \param header        Header to check
+     * \param expected      Header the filter would have if it was saved by
+     *                      the loading code, with the parameters of
+     *                      <code>header</code>
+     * \param file_size     Size of the whole file, if known, or 0
+     * \throw std::runtime_error if the header does not match
+     */
+    inline void check_header(file_header const& header, file_header const& expected,
+            std::uint64_t const file_size = 0)
+    {
+        if (header.magic != file_header::magic_value)
+            throw std::runtime_error("not a bloom filter file");
+        if (header.version != file_header::current_version)
+            throw std::runtime_error("unsupported bloom filter file version "
+                    + std::to_string(header.version));
+        if (header.kind != expected.kind)
+            throw std::runtime_error("file holds a different kind of filter");
+        if (header.hashing != expected.hashing)
+            throw std::runtime_error("filter was saved with a different hashing scheme");
+        if (header.hasher != expected.hasher)
+            throw std::runtime_error("filter was saved with a different hasher");
+        // the offset and end of the data must not overflow
+        constexpr std::uint64_t const max = std::numeric_limits<std::uint64_t>::max();
+        if (header.num_salts > (max - sizeof(file_header) - cache_line_size) / sizeof(std::uint64_t)
+                or header.data_size > max - header.data_offset)
+            throw std::runtime_error("bloom filter file has an inconsistent layout");
+        if (header.data_offset != expected.data_offset or header.data_size != expected.data_size)
+            throw std::runtime_error("bloom filter file has an inconsistent layout");
+        if (file_size != 0 and file_size < header.data_offset + header.data_size)
+            throw std::runtime_error("bloom filter file is truncated");
+    }
+
+    /**
+     * Check that a header describes a bloom filter that can be loaded with
+     * the given hashing scheme and hasher.
+     *
+     * \param header        Header to check
+     * \param file_size     Size of the whole file, if known, or 0
+     * \throw std::runtime_error if the header does not match
+     */
+    template<typename hashing, typename hasher>
+    void check_header(file_header const& header, std::uint64_t const file_size = 0)
+    {
+        check_header(header, make_header<hashing, hasher>(
+                    header.num_bits, header.num_hash_functions, header.num_salts), file_size);
+        // the size of the bit array in words must not overflow either
+        if (header.num_bits == 0 or header.num_hash_functions == 0
+                or header.num_bits > std::numeric_limits<std::uint64_t>::max() - (bit_array::word_bits - 1)
+                or header.num_salts != expected_num_salts<hashing>(header.num_hash_functions))
+            throw std::runtime_error("bloom filter file has invalid parameters");
+    }
+
+    /**
+     * Write a filter to a stream.
+     *
+     * \param out       Stream to write to
+     * \param header    Header of the filter
+     * \param salts     Salt values of the filter
+     * \param data      Filter data, <code>header.data_size</code> bytes
+     */
+    inline void write_filter(std::ostream& out, file_header const& header,
+            std::vector<size_t> const& salts, void const* data)
+    {
+        out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        for (std::uint64_t const salt : salts)
+        {
+            out.write(reinterpret_cast<char const*>(&salt), sizeof(salt));
+        }
+        std::vector<char> const padding (header.data_offset
+                - sizeof(header) - salts.size() * sizeof(std::uint64_t));
+        out.write(padding.data(), padding.size());
+        out.write(static_cast<char const*>(data), header.data_size);
+        if (not out)
+            throw std::runtime_error("could not write bloom filter");
+    }
+
+    /**
+     * Read the header of a filter from a stream.
+     *
+     * \param in    Stream to read from
+     * \return      Header of the filter, not yet checked
+     */
+    inline file_header read_header(std::istream& in)
+    {
+        file_header header;
+        if (not in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+            throw std::runtime_error("bloom filter file is truncated");
+        return header;
+    }
+
+    /**
+     * Read the salt values of a filter, following its header, from a
+     * stream. The stream is left at the start of the filter data.
+     *
+     * \param in        Stream to read from
+     * \param header    Checked header of the filter
+     * \param salts     Output, salt values of the filter
+     */
+    inline void read_salts(std::istream& in, file_header const& header, std::vector<size_t>& salts)
+    {
+        // the size of a stream is unknown, so a count beyond the end of a
+        // short stream must not be allocated up front
+        salts.clear();
+        for (std::uint64_t i = 0; i < header.num_salts; ++i)
+        {
+            std::uint64_t s;
+            if (not in.read(reinterpret_cast<char*>(&s), sizeof(s)))
+                throw std::runtime_error("bloom filter file is truncated");
+            salts.push_back(s);
+        }
+        in.ignore(header.data_offset - sizeof(header) - header.num_salts * sizeof(std::uint64_t));
+    }
+
+    /**
+     * Read the header and salt values of a bloom filter from a stream. The
+     * stream is left at the start of the bit array.
+     *
+     * \param in        Stream to read from
+     * \param salts     Output, salt values of the filter
+     * \return          Header of the filter
+     */
+    template<typename hashing, typename hasher>
+    file_header read_filter_header(std::istream& in, std::vector<size_t>& salts)
+    {
+        auto const header = read_header(in);
+        check_header<hashing, hasher>(header);
+        read_salts(in, header, salts);
+        return header;
+    }
+
+    /**
+     * Read-only memory mapping of a whole file. The mapping is shared with
+     * all other processes mapping the same file, through the page cache.
+     */
+    class mapped_file
+    {
+        public:
+            /**
+             * Constructor. Maps the file.
+             *
+             * \param path  Path of the file
+             * \throw std::system_error if the file can not be mapped
+             */
+            explicit mapped_file(std::string const& path)
+            :   m_data(nullptr),
+                m_size(0)
+            {
+#if defined(__linux__)
+                int const fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                if (fd < 0)
+                    throw std::system_error(errno, std::generic_category(), "could not open " + path);
+
+                struct stat st;
+                if (fstat(fd, &st) != 0)
+                {
+                    int const error = errno;
+                    close(fd);
+                    throw std::system_error(error, std::generic_category(), "could not stat " + path);
+                }
+                m_size = static_cast<size_t>(st.st_size);
+                if (m_size == 0)
+                {
+                    close(fd);
+                    throw std::runtime_error(path + " is empty");
+                }
+
+                void* p = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+                int const error = errno;
+                // the mapping keeps the file alive
+                close(fd);
+                if (p == MAP_FAILED)
+                    throw std::system_error(error, std::generic_category(), "could not map " + path);
+                // probes touch random pages, read-ahead would only waste I/O
+                madvise(p, m_size, MADV_RANDOM);
+                m_data = p;
+#else
+                (void) path;
+                throw std::runtime_error("memory mapping is not supported on this platform");
+#endif
+            }
+
+            mapped_file(mapped_file const&) = delete;
+            mapped_file& operator= (mapped_file const&) = delete;
+
+            /**
+             * Move constructor.
+             *
+             * \param other     Other mapped_file object (moved from)
+             */
+            mapped_file(mapped_file&& other) noexcept
+            :   m_data(std::exchange(other.m_data, nullptr)),
+                m_size(std::exchange(other.m_size, 0))
+            {
+                // ctor
+            }
+
+            /**
+             * Move assignment operator.
+             *
+             * \param other     Other mapped_file object (moved from)
+             * \return          A reference to this
+             */
+            mapped_file& operator= (mapped_file&& other) noexcept
+            {
+                std::swap(m_data, other.m_data);
+                std::swap(m_size, other.m_size);
+
+                return *this;
+            }
+
+            /**
+             * Destructor. Unmaps the file.
+             */
+            ~mapped_file()
+            {
+#if defined(__linux__)
+                if (m_data != nullptr) munmap(m_data, m_size);
+#endif
+            }
+
+            /**
+             * \return      Pointer to the first byte of the file
+             */
+            void const* data() const { return m_data; }
+
+            /**
+             * \return      Size of the file in bytes
+             */
+            size_t size() const { return m_size; }
+
+        private:
+            /**
+             * Start of the mapping.
+             */
+            void* m_data;
+
+            /**
+             * Size of the mapping in bytes.
+             */
+            size_t m_size;
+    }; // class mapped_file
+} // namespace detail
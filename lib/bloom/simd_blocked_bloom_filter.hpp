@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+#include "bit_array.hpp"
+#include "probe_kernels.hpp"
+
+#pragma once
+
+/**
+ * Blocked bloom filter for integer keys whose probes are vectorized. The
+ * bits are split into blocks of 256 bits, i.e. 8 32-bit words, and every key
+ * sets exactly one bit in each word of its block (a "split block" bloom
+ * filter). Because the number of hash functions is fixed to 8 and all of
+ * them are multiplications, <code>test_batch</code> can hash 4 (AVX2) or 8
+ * (AVX-512) keys per instruction and check their blocks with gathers.
+ *
+ * The kernel is selected at runtime from the features of the CPU, with a
+ * scalar fallback, and all kernels give identical results.
+ *
+ * Thread safety: as for <code>dynamic_bloom_filter</code>, any number of
+ * threads may call the const member functions concurrently.
+ *
+ * At 8 bits per key, i.e. <code>num_bits = 8 * n</code>, the false positive
+ * rate is about 2%; at 16 bits per key it is about 0.1%.
+ *
+ * \param T     Integer type of the keys.
+ */
+template<typename T>
+class simd_blocked_bloom_filter
+{
+    public:
+        static_assert(std::is_integral_v<T>, "Keys must be integers.");
+        static_assert(sizeof(T) <= sizeof(std::uint64_t), "Keys must fit 64 bits.");
+
+        /**
+         * Number of bits in one block.
+         */
+        static constexpr size_t const block_bits = 32 * detail::probe::block_words;
+
+        /**
+         * Constructor. Derives the seed of the hash function from the
+         * default seed.
+         *
+         * \param num_bits      Number of bits in the filter, rounded up to a
+         *                      multiple of <code>block_bits</code>
+         * \param huge_pages    Whether to try to back the bits with huge
+         *                      pages
+         */
+        explicit simd_blocked_bloom_filter(size_t const num_bits, bool const huge_pages = false)
+        :   m_num_blocks((num_bits + block_bits - 1) / block_bits),
+            m_seed(),
+            m_hash_hits(m_num_blocks * block_bits, huge_pages),
+            m_test_batch(detail::probe::select_test_batch())
+        {
+            if (num_bits == 0)
+                throw std::invalid_argument("bloom filter needs at least one bit");
+            if (m_num_blocks > std::numeric_limits<std::uint32_t>::max())
+                throw std::invalid_argument("bloom filter has too many blocks");
+
+            std::uint64_t seed = detail::default_seed;
+            m_seed = detail::splitmix64(seed);
+        };
+
+        /**
+         * Destructor.
+         */
+        ~simd_blocked_bloom_filter() = default;
+
+        /**
+         * Add a value to the filter.
+         *
+         * \param t     Value to add
+         */
+        void add(T const t)
+        {
+            detail::probe::add(words(), m_num_blocks, m_seed, static_cast<std::uint64_t>(t));
+        };
+
+        /**
+         * Test whether a value is in the filter. The return value
+         * <code>false</code> means that the value is <i>guaranteed</i> not to
+         * be in the filter. The return value <code>true</code> means that the
+         * value <i>maybe</i> is in the set.
+         *
+         * \param t     Data item to check for
+         * \return      Boolean value indicating membership
+         */
+        bool test(T const t) const
+        {
+            return detail::probe::test(words(), m_num_blocks, m_seed, static_cast<std::uint64_t>(t));
+        };
+
+        /**
+         * Add several values to the filter. The block of each value is
+         * prefetched <code>prefetch_distance</code> values ahead.
+         *
+         * \param values    Pointer to the first value
+         * \param count     Number of values
+         */
+        void add_batch(T const* values, size_t const count)
+        {
+            for (size_t j = 0; j < count; ++j)
+            {
+                if (j + prefetch_distance < count)
+                {
+                    auto const hash = detail::probe::hash_key(
+                            static_cast<std::uint64_t>(values[j + prefetch_distance]), m_seed);
+                    detail::prefetch_write(words()
+                            + detail::probe::block_of(hash, m_num_blocks) * detail::probe::block_words);
+                }
+                add(values[j]);
+            }
+        };
+
+        /**
+         * Test several values for membership, with the widest vector kernel
+         * the CPU supports.
+         *
+         * \param values    Pointer to the first value
+         * \param count     Number of values
+         * \param results   Bitmap of at least <code>(count + 63) / 64</code>
+         *                  words. Bit <code>i % 64</code> of word
+         *                  <code>i / 64</code> is set to the result for the
+         *                  i-th value; the other bits of the last word are
+         *                  cleared.
+         */
+        void test_batch(T const* values, size_t const count, std::uint64_t* results) const
+        {
+            std::fill(results, results + (count + 63) / 64, 0);
+
+            if constexpr (sizeof(T) == sizeof(std::uint64_t))
+            {
+                m_test_batch(words(), m_num_blocks, m_seed,
+                        reinterpret_cast<std::uint64_t const*>(values), count, results);
+            }
+            else
+            {
+                // widen the keys in chunks of a whole number of result words
+                constexpr size_t const chunk = 256;
+                std::uint64_t keys[chunk];
+                for (size_t first = 0; first < count; first += chunk)
+                {
+                    size_t const n = std::min(chunk, count - first);
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        keys[j] = static_cast<std::uint64_t>(values[first + j]);
+                    }
+                    m_test_batch(words(), m_num_blocks, m_seed, keys, n, results + first / 64);
+                }
+            }
+        };
+
+        /**
+         * \return      Number of bits in the filter
+         */
+        size_t num_bits() const { return m_hash_hits.size(); }
+
+        /**
+         * \return      Number of blocks in the filter
+         */
+        size_t num_blocks() const { return m_num_blocks; }
+
+        /**
+         * \return      Number of hash functions used per value
+         */
+        size_t num_hash_functions() const { return detail::probe::block_words; }
+
+    private:
+        /**
+         * Number of values <code>add_batch</code> looks ahead to prefetch.
+         */
+        static constexpr size_t const prefetch_distance = 16;
+
+        /**
+         * \return      The bits as 32-bit words
+         */
+        std::uint32_t* words()
+        {
+            return reinterpret_cast<std::uint32_t*>(m_hash_hits.data());
+        }
+
+        /**
+         * \return      The bits as 32-bit words
+         */
+        std::uint32_t const* words() const
+        {
+            return reinterpret_cast<std::uint32_t const*>(m_hash_hits.data());
+        }
+
+        /**
+         * Number of blocks in the filter.
+         */
+        size_t m_num_blocks;
+
+        /**
+         * Seed of the hash function.
+         */
+        std::uint64_t m_seed;
+
+        /**
+         * The bits set by hash function hits, <code>m_num_blocks</code>
+         * blocks of <code>block_bits</code> bits each.
+         */
+        detail::bit_array m_hash_hits;
+
+        /**
+         * The batch test kernel for this CPU.
+         */
+        detail::probe::test_batch_fn m_test_batch;
+};
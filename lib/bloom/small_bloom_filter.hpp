@@ -0,0 +1,201 @@
+#include <array>
+#include <cstdint>
+
+#include "hash_fn.hpp"
+#include "hashers.hpp"
+
+#pragma once
+
+namespace detail
+{
+    /**
+     * The constants of a <code>small_bloom_filter</code>: the seed of its
+     * hash, then the odd multipliers of its indices, all drawn from
+     * SplitMix64.
+     *
+     * \param seed      Seed of the filter
+     * \return          Hash seed and <code>num_indices</code> multipliers
+     */
+    template<size_t num_indices>
+    constexpr std::array<std::uint64_t, num_indices + 1> small_filter_constants(std::uint64_t seed)
+    {
+        std::array<std::uint64_t, num_indices + 1> values {};
+        values[0] = splitmix64(seed);
+        for (size_t i = 1; i < values.size(); ++i) values[i] = splitmix64(seed) | 1;
+        return values;
+    }
+} // namespace detail
+
+/**
+ * Bloom filter of at most 512 bits that lives entirely in the object, e.g.
+ * one per row of a table. The bits are one to eight 64-bit words in place,
+ * without a heap allocation or a size field, so thousands of filters are a
+ * plain array and one filter fits a register or a single cache line.
+ *
+ * All parameters are compile-time constants. A value is hashed once; its
+ * <code>num_hash_functions</code> indices are taken from that hash by
+ * multiply-shift with odd constants that are derived from the seed at
+ * compile time, so computing them costs one multiplication each. The
+ * indices are gathered into a mask of the filter's size, and a test is a
+ * single compare of the words against the mask, which the compiler unrolls
+ * and, for 512 bits with AVX-512, turns into one vector compare.
+ *
+ * For larger filters, or to save, load or build filters in parallel, use
+ * <code>bloom_filter</code>, <code>sized_bloom_filter</code> or
+ * <code>dynamic_bloom_filter</code>.
+ *
+ * \param T                     Template parameter for the type to build the
+ *                              filter for.
+ * \param num_bits              Number of bits in the filter, at most 512.
+ * \param num_hash_functions    Number of indices per value.
+ * \param hasher                Hasher, see <code>bloom_filter</code>.
+ * \param seed                  Seed of the hash and index constants.
+ *                              Filters with the same parameters and seed
+ *                              can be combined.
+ */
+template<typename T, size_t num_bits, size_t num_hash_functions,
+    typename hasher = wyhash_hasher, std::uint64_t seed = detail::default_seed>
+class small_bloom_filter
+{
+    public:
+        static_assert(num_bits > 0, "Bloom filter needs at least one bit.");
+        static_assert(num_bits <= 512, "Small bloom filters have at most 512 bits, use bloom_filter.");
+        static_assert(num_hash_functions > 0, "Bloom filter needs at least one hash function.");
+
+        /**
+         * Number of 64-bit words holding the bits.
+         */
+        static constexpr size_t const num_words = (num_bits + 63) / 64;
+
+        /**
+         * Bits of a filter, or the bits of one value.
+         */
+        using words_t = std::array<std::uint64_t, num_words>;
+
+        /**
+         * Constructor. All bits are initially unset.
+         */
+        constexpr small_bloom_filter() : m_words{} {};
+
+        /**
+         * Add a value to the filter.
+         *
+         * \param t     Value to add
+         */
+        void add(T const& t)
+        {
+            words_t const bits = mask(t);
+            for (size_t w = 0; w < num_words; ++w) m_words[w] |= bits[w];
+        };
+
+        /**
+         * Test whether a value is in the filter, see
+         * <code>dynamic_bloom_filter::test</code>.
+         *
+         * \param t     Data item to check for
+         * \return      Boolean value indicating membership
+         */
+        bool test(T const& t) const
+        {
+            words_t const bits = mask(t);
+            std::uint64_t missing = 0;
+            for (size_t w = 0; w < num_words; ++w) missing |= bits[w] & ~m_words[w];
+            return missing == 0;
+        };
+
+        /**
+         * Add all values of another filter, see
+         * <code>dynamic_bloom_filter::merge</code>.
+         *
+         * \param other     Other filter
+         * \return          A reference to this
+         */
+        constexpr small_bloom_filter& operator|= (small_bloom_filter const& other)
+        {
+            for (size_t w = 0; w < num_words; ++w) m_words[w] |= other.m_words[w];
+            return *this;
+        };
+
+        /**
+         * Keep only the bits set in both filters, see
+         * <code>dynamic_bloom_filter::operator&=</code>.
+         *
+         * \param other     Other filter
+         * \return          A reference to this
+         */
+        constexpr small_bloom_filter& operator&= (small_bloom_filter const& other)
+        {
+            for (size_t w = 0; w < num_words; ++w) m_words[w] &= other.m_words[w];
+            return *this;
+        };
+
+        /**
+         * \param other     Other filter
+         * \return          Whether the filters have the same bits
+         */
+        constexpr bool operator== (small_bloom_filter const& other) const
+        {
+            std::uint64_t diff = 0;
+            for (size_t w = 0; w < num_words; ++w) diff |= m_words[w] ^ other.m_words[w];
+            return diff == 0;
+        };
+
+        /**
+         * \param other     Other filter
+         * \return          Whether the filters differ
+         */
+        constexpr bool operator!= (small_bloom_filter const& other) const
+        {
+            return not (*this == other);
+        };
+
+        /**
+         * Unset all bits.
+         */
+        constexpr void clear() { m_words = {}; }
+
+        /**
+         * \return      Number of set bits
+         */
+        size_t num_set_bits() const
+        {
+            size_t set = 0;
+            for (auto const word : m_words) set += __builtin_popcountll(word);
+            return set;
+        }
+
+        /**
+         * \return      Bits of the filter
+         */
+        constexpr words_t const& words() const { return m_words; }
+
+        /**
+         * Compute the bits of a value: one hash, then one multiply-shift
+         * per index.
+         *
+         * \param t     Value
+         * \return      Mask with the bits of the value set
+         */
+        static words_t mask(T const& t)
+        {
+            std::uint64_t const hash = hasher{}(t, constants[0]);
+            words_t bits {};
+            for (size_t i = 0; i < num_hash_functions; ++i)
+            {
+                std::uint64_t const idx = detail::fast_range(hash * constants[i + 1], num_bits);
+                bits[idx / 64] |= std::uint64_t{1} << (idx % 64);
+            }
+            return bits;
+        }
+
+    private:
+        /**
+         * The hash seed and the index multipliers.
+         */
+        static constexpr auto const constants = detail::small_filter_constants<num_hash_functions>(seed);
+
+        /**
+         * The bits of the filter.
+         */
+        alignas(num_words == 8 ? 64 : 8) words_t m_words;
+};
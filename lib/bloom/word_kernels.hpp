@@ -0,0 +1,278 @@
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#pragma once
+
+namespace detail
+{
+    /**
+     * Kernels combining or counting whole arrays of 64-bit words, used for
+     * the set operations and fill statistics of bloom filters. All kernels
+     * of one operation compute exactly the same; they only differ in how
+     * many words they process per instruction. The arrays need not be
+     * aligned.
+     */
+    namespace words
+    {
+        /**
+         * Signature of the kernels that combine <code>src</code> into
+         * <code>dst</code>.
+         */
+        using combine_fn = void (*)(std::uint64_t* dst, std::uint64_t const* src, size_t count);
+
+        /**
+         * Signature of the kernels that compare two arrays.
+         */
+        using equal_fn = bool (*)(std::uint64_t const* a, std::uint64_t const* b, size_t count);
+
+        /**
+         * Signature of the kernels that count the set bits of an array.
+         */
+        using count_fn = size_t (*)(std::uint64_t const* words, size_t count);
+
+        inline void or_scalar(std::uint64_t* dst, std::uint64_t const* src, size_t const count)
+        {
+            for (size_t i = 0; i < count; ++i) dst[i] |= src[i];
+        }
+
+        inline void and_scalar(std::uint64_t* dst, std::uint64_t const* src, size_t const count)
+        {
+            for (size_t i = 0; i < count; ++i) dst[i] &= src[i];
+        }
+
+        inline bool equal_scalar(std::uint64_t const* a, std::uint64_t const* b, size_t const count)
+        {
+            std::uint64_t diff = 0;
+            for (size_t i = 0; i < count; ++i) diff |= a[i] ^ b[i];
+            return diff == 0;
+        }
+
+        inline size_t popcount_scalar(std::uint64_t const* words, size_t const count)
+        {
+            size_t bits = 0;
+            for (size_t i = 0; i < count; ++i) bits += __builtin_popcountll(words[i]);
+            return bits;
+        }
+
+#if defined(__x86_64__)
+        /**
+         * Uses the popcnt instruction, with four independent sums so that
+         * its latency is hidden.
+         */
+        __attribute__((target("popcnt")))
+        inline size_t popcount_popcnt(std::uint64_t const* words, size_t const count)
+        {
+            size_t sums[4] = { 0, 0, 0, 0 };
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                sums[0] += __builtin_popcountll(words[i]);
+                sums[1] += __builtin_popcountll(words[i + 1]);
+                sums[2] += __builtin_popcountll(words[i + 2]);
+                sums[3] += __builtin_popcountll(words[i + 3]);
+            }
+            for (; i < count; ++i) sums[0] += __builtin_popcountll(words[i]);
+            return sums[0] + sums[1] + sums[2] + sums[3];
+        }
+
+        __attribute__((target("avx2")))
+        inline void or_avx2(std::uint64_t* dst, std::uint64_t const* src, size_t const count)
+        {
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                auto* d = reinterpret_cast<__m256i*>(dst + i);
+                __m256i const s = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + i));
+                _mm256_storeu_si256(d, _mm256_or_si256(_mm256_loadu_si256(d), s));
+            }
+            or_scalar(dst + i, src + i, count - i);
+        }
+
+        __attribute__((target("avx2")))
+        inline void and_avx2(std::uint64_t* dst, std::uint64_t const* src, size_t const count)
+        {
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                auto* d = reinterpret_cast<__m256i*>(dst + i);
+                __m256i const s = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + i));
+                _mm256_storeu_si256(d, _mm256_and_si256(_mm256_loadu_si256(d), s));
+            }
+            and_scalar(dst + i, src + i, count - i);
+        }
+
+        /**
+         * Compares a cache line per iteration and stops at the first
+         * difference, so unequal filters are usually rejected early.
+         */
+        __attribute__((target("avx2")))
+        inline bool equal_avx2(std::uint64_t const* a, std::uint64_t const* b, size_t const count)
+        {
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                auto const* pa = reinterpret_cast<__m256i const*>(a + i);
+                auto const* pb = reinterpret_cast<__m256i const*>(b + i);
+                __m256i const diff = _mm256_or_si256(
+                        _mm256_xor_si256(_mm256_loadu_si256(pa), _mm256_loadu_si256(pb)),
+                        _mm256_xor_si256(_mm256_loadu_si256(pa + 1), _mm256_loadu_si256(pb + 1)));
+                if (not _mm256_testz_si256(diff, diff)) return false;
+            }
+            return equal_scalar(a + i, b + i, count - i);
+        }
+
+        /**
+         * Counts the bits of each nibble with a table lookup in a shuffle
+         * and sums the bytes per 64-bit lane (Mula, Kurz and Lemire,
+         * "Faster Population Counts Using AVX2 Instructions").
+         */
+        __attribute__((target("avx2")))
+        inline size_t popcount_avx2(std::uint64_t const* words, size_t const count)
+        {
+            __m256i const table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+            __m256i const nibble = _mm256_set1_epi8(0x0f);
+            __m256i sums = _mm256_setzero_si256();
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                __m256i const v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(words + i));
+                __m256i const bytes = _mm256_add_epi8(
+                        _mm256_shuffle_epi8(table, _mm256_and_si256(v, nibble)),
+                        _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+                sums = _mm256_add_epi64(sums, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+            }
+            std::uint64_t lanes[4];
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), sums);
+            return lanes[0] + lanes[1] + lanes[2] + lanes[3] + popcount_scalar(words + i, count - i);
+        }
+
+        __attribute__((target("avx512f")))
+        inline void or_avx512(std::uint64_t* dst, std::uint64_t const* src, size_t const count)
+        {
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                __m512i const s = _mm512_loadu_si512(src + i);
+                _mm512_storeu_si512(dst + i, _mm512_or_si512(_mm512_loadu_si512(dst + i), s));
+            }
+            or_scalar(dst + i, src + i, count - i);
+        }
+
+        __attribute__((target("avx512f")))
+        inline void and_avx512(std::uint64_t* dst, std::uint64_t const* src, size_t const count)
+        {
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                __m512i const s = _mm512_loadu_si512(src + i);
+                _mm512_storeu_si512(dst + i, _mm512_and_si512(_mm512_loadu_si512(dst + i), s));
+            }
+            and_scalar(dst + i, src + i, count - i);
+        }
+
+        __attribute__((target("avx512f")))
+        inline bool equal_avx512(std::uint64_t const* a, std::uint64_t const* b, size_t const count)
+        {
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                if (_mm512_cmpneq_epi64_mask(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i)) != 0)
+                    return false;
+            }
+            return equal_scalar(a + i, b + i, count - i);
+        }
+
+        /**
+         * The nibble lookup of <code>popcount_avx2</code> on whole cache
+         * lines.
+         */
+        __attribute__((target("avx512bw")))
+        inline size_t popcount_avx512(std::uint64_t const* words, size_t const count)
+        {
+            // bit counts of the nibbles 0 to 15 in every 128-bit lane
+            std::int64_t const low = 0x0302020102010100;
+            std::int64_t const high = 0x0403030203020201;
+            __m512i const table = _mm512_set_epi64(high, low, high, low, high, low, high, low);
+            __m512i const nibble = _mm512_set1_epi8(0x0f);
+            __m512i sums = _mm512_setzero_si512();
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                __m512i const v = _mm512_loadu_si512(words + i);
+                __m512i const bytes = _mm512_add_epi8(
+                        _mm512_shuffle_epi8(table, _mm512_and_si512(v, nibble)),
+                        _mm512_shuffle_epi8(table, _mm512_and_si512(_mm512_srli_epi16(v, 4), nibble)));
+                sums = _mm512_add_epi64(sums, _mm512_sad_epu8(bytes, _mm512_setzero_si512()));
+            }
+            std::uint64_t lanes[8];
+            _mm512_storeu_si512(lanes, sums);
+            size_t bits = popcount_scalar(words + i, count - i);
+            for (auto const lane : lanes) bits += lane;
+            return bits;
+        }
+#endif
+
+        /**
+         * The kernels of all operations for one instruction set.
+         */
+        struct kernels
+        {
+            combine_fn bitwise_or;
+            combine_fn bitwise_and;
+            equal_fn equal;
+        };
+
+        /**
+         * Pick the widest kernels the CPU supports. The choice is made once
+         * at runtime, so one binary runs on machines with and without AVX2
+         * or AVX-512.
+         *
+         * \return      Kernels
+         */
+        inline kernels const& select()
+        {
+            static kernels const selected = []
+            {
+#if defined(__x86_64__)
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx512f"))
+                    return kernels{ or_avx512, and_avx512, equal_avx512 };
+                if (__builtin_cpu_supports("avx2"))
+                    return kernels{ or_avx2, and_avx2, equal_avx2 };
+#endif
+                return kernels{ or_scalar, and_scalar, equal_scalar };
+            }();
+            return selected;
+        }
+
+        /**
+         * Pick the fastest bit counting kernel the CPU supports, see
+         * <code>select</code>. It is chosen separately, because the
+         * AVX-512 kernel needs AVX-512BW, which not all AVX-512 CPUs have.
+         *
+         * \return      Kernel
+         */
+        inline count_fn select_popcount()
+        {
+            static count_fn const selected = []
+            {
+#if defined(__x86_64__)
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("avx512bw"))
+                    return popcount_avx512;
+                if (__builtin_cpu_supports("avx2"))
+                    return popcount_avx2;
+                if (__builtin_cpu_supports("popcnt"))
+                    return popcount_popcnt;
+#endif
+                return popcount_scalar;
+            }();
+            return selected;
+        }
+    } // namespace words
+} // namespace detail
@@ -0,0 +1,169 @@
+#include <cstdint>
+#include <iostream>
+#include <list>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../lib/bloom_filter"
+
+/**
+ * Build filters over a key set, then check members, false positive rate,
+ * that the number of threads does not change the filter, and batch tests.
+ */
+template<size_t fingerprint_bits>
+bool check(double const max_fpr)
+{
+    constexpr size_t const num_keys = 1000000;
+    std::vector<std::uint64_t> keys;
+    for (std::uint64_t i = 0; i < num_keys; ++i) keys.push_back(i * 7919);
+
+    binary_fuse_filter<std::uint64_t, fingerprint_bits> filter (keys.begin(), keys.end());
+    binary_fuse_filter<std::uint64_t, fingerprint_bits> parallel (keys.begin(), keys.end(), 4);
+
+    if (filter.size() != num_keys)
+    {
+        std::cerr << "Filter lost keys!\n";
+        return false;
+    }
+    for (auto const k : keys)
+    {
+        if (not filter.test(k))
+        {
+            std::cerr << "Tested for membership of value and got false negative!\n";
+            return false;
+        }
+    }
+
+    size_t false_positives = 0;
+    size_t disagreements = 0;
+    std::vector<std::uint64_t> others;
+    for (std::uint64_t i = 0; i < num_keys; ++i) others.push_back(i * 7919 + 1);
+    for (auto const k : others)
+    {
+        false_positives += filter.test(k);
+        disagreements += filter.test(k) != parallel.test(k);
+    }
+    double const fpr = static_cast<double>(false_positives) / num_keys;
+    if (fpr > max_fpr)
+    {
+        std::cerr << fingerprint_bits << " bit fingerprints have a false positive rate of " << fpr << "!\n";
+        return false;
+    }
+    if (disagreements != 0)
+    {
+        std::cerr << "Filter built with threads differs!\n";
+        return false;
+    }
+
+    double const bits_per_key = static_cast<double>(filter.num_bits()) / num_keys;
+    if (bits_per_key > 1.15 * fingerprint_bits)
+    {
+        std::cerr << fingerprint_bits << " bit fingerprints take " << bits_per_key << " bits per key!\n";
+        return false;
+    }
+
+    std::vector<std::uint64_t> results ((others.size() + 63) / 64);
+    filter.test_batch(others.data(), others.size(), results.data());
+    for (size_t i = 0; i < others.size(); ++i)
+    {
+        if (((results[i / 64] >> (i % 64)) & 1) != filter.test(others[i]))
+        {
+            std::cerr << "Batch test differs from single tests!\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    if (not check<8>(0.005)) return 1;
+    if (not check<16>(0.0001)) return 1;
+
+    // any forward range works, duplicates are skipped
+    std::list<std::string> words;
+    for (size_t i = 0; i < 1000; ++i) words.push_back("word " + std::to_string(i % 500));
+    binary_fuse_filter<std::string> strings (words.begin(), words.end());
+    if (strings.size() != 500)
+    {
+        std::cerr << "Duplicates were not skipped!\n";
+        return 1;
+    }
+    for (auto const& w : words)
+    {
+        if (not strings.test(w))
+        {
+            std::cerr << "Tested for membership of string and got false negative!\n";
+            return 1;
+        }
+    }
+
+    // tiny and empty key sets
+    std::vector<int> const one { 42 };
+    binary_fuse_filter<int> single (one.begin(), one.end());
+    if (not single.test(42))
+    {
+        std::cerr << "Filter of a single key misses it!\n";
+        return 1;
+    }
+    binary_fuse_filter<int> empty (one.begin(), one.begin());
+    for (int i = 0; i < 1000; ++i)
+    {
+        if (empty.test(i))
+        {
+            std::cerr << "Empty filter reports a member!\n";
+            return 1;
+        }
+    }
+
+    // round trip through a stream
+    std::stringstream stream;
+    strings.save(stream);
+    auto const loaded = binary_fuse_filter<std::string>::load(stream);
+    if (loaded.num_bits() != strings.num_bits() or loaded.size() != strings.size())
+    {
+        std::cerr << "Loaded filter has different parameters!\n";
+        return 1;
+    }
+    for (size_t i = 0; i < 10000; ++i)
+    {
+        auto const w = "word " + std::to_string(i);
+        if (loaded.test(w) != strings.test(w))
+        {
+            std::cerr << "Loaded filter answers differently!\n";
+            return 1;
+        }
+    }
+
+    std::stringstream empty_stream;
+    empty.save(empty_stream);
+    if (binary_fuse_filter<int>::load(empty_stream).test(42))
+    {
+        std::cerr << "Loaded empty filter reports a member!\n";
+        return 1;
+    }
+
+    // files of other filters and fingerprint sizes are rejected
+    std::stringstream bloom_stream;
+    dynamic_bloom_filter<std::string>(1000, 3).save(bloom_stream);
+    std::stringstream fuse_stream;
+    strings.save(fuse_stream);
+    size_t rejected = 0;
+    try { binary_fuse_filter<std::string>::load(bloom_stream); }
+    catch (std::runtime_error const&) { ++rejected; }
+    try { dynamic_bloom_filter<std::string>::load(fuse_stream); }
+    catch (std::runtime_error const&) { ++rejected; }
+    std::stringstream wide_stream;
+    strings.save(wide_stream);
+    try { binary_fuse_filter<std::string, 16>::load(wide_stream); }
+    catch (std::runtime_error const&) { ++rejected; }
+    if (rejected != 3)
+    {
+        std::cerr << "Loaded a file of a different filter!\n";
+        return 1;
+    }
+
+    return 0;
+}
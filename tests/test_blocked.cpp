@@ -0,0 +1,64 @@
+#include <set>
+#include <random>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../lib/bloom_filter"
+
+int main()
+{
+    constexpr size_t const num_hash_fns = 8;
+    constexpr size_t const num_bits     = 1000000;
+
+    constexpr size_t const num_test_items { 100000 };
+    std::default_random_engine generator;
+    std::uniform_int_distribution<long> dist (
+            std::numeric_limits<long>::min(), std::numeric_limits<long>::max());
+
+    std::set<std::string> strings;
+    blocked_bloom_filter<std::string> filter (num_bits, num_hash_fns);
+    if (filter.num_bits() % blocked_bloom_filter<std::string>::block_bits != 0
+            or filter.num_bits() < num_bits)
+    {
+        std::cerr << "Filter size is not a whole number of blocks!\n";
+        return 1;
+    }
+
+    for (size_t i = 0; i < num_test_items; ++i)
+    {
+        auto const x = std::to_string(dist(generator));
+        strings.insert(x);
+        filter.add(x);
+    }
+
+    // check true positives
+    for (auto& str : strings)
+    {
+        if (not filter.test(str))
+        {
+            std::cerr << "Tested for membership of value \"" << str << "\" and got false negative!\n";
+            return 1;
+        }
+    }
+
+    // the batch interface must agree with the single value interface, for
+    // members and (mostly) non-members alike
+    std::vector<std::string> values (strings.begin(), strings.end());
+    for (size_t i = 0; i < num_test_items; ++i) values.push_back(std::to_string(dist(generator)));
+
+    blocked_bloom_filter<std::string> batch_filter (num_bits, num_hash_fns);
+    batch_filter.add_batch(values.data(), strings.size());
+
+    std::vector<std::uint64_t> results ((values.size() + 63) / 64);
+    batch_filter.test_batch(values.data(), values.size(), results.data());
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        bool const batch_result = (results[i / 64] >> (i % 64)) & 1u;
+        if (batch_result != filter.test(values[i]))
+        {
+            std::cerr << "Batch and single value interface disagree!\n";
+            return 1;
+        }
+    }
+}
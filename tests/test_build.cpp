@@ -0,0 +1,99 @@
+#include <cstdint>
+#include <iostream>
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../lib/bloom_filter"
+
+/**
+ * Hasher that fails for one value, as a user hasher might.
+ */
+struct throwing_hasher
+{
+    static constexpr std::uint64_t const poison = 12345;
+
+    std::uint64_t operator()(std::uint64_t const value, std::uint64_t const seed) const
+    {
+        if (value == poison) throw std::runtime_error("can not hash the poison value");
+        return wyhash_hasher{}(value, seed);
+    }
+};
+
+int main()
+{
+    constexpr size_t const num_hash_fns = 7;
+    constexpr size_t const num_bits     = 9585059; // not a multiple of 64
+    constexpr size_t const num_values   = 1000000;
+
+    std::vector<std::uint64_t> values;
+    for (std::uint64_t i = 0; i < num_values; ++i) values.push_back(i * 0x9e3779b97f4a7c15ull);
+
+    dynamic_bloom_filter<std::uint64_t> expected (num_bits, num_hash_fns);
+    for (auto const v : values) expected.add(v);
+
+    // any number of threads builds the same filter as adding one by one,
+    // including more threads than values per round and uneven slices
+    for (size_t const threads : { 0, 1, 2, 3, 4, 7 })
+    {
+        dynamic_bloom_filter<std::uint64_t> built (num_bits, num_hash_fns);
+        built.build(values.begin(), values.end(), threads);
+        if (built != expected)
+        {
+            std::cerr << "Filter built with " << threads << " threads differs!\n";
+            return 1;
+        }
+    }
+
+    // build adds to what is already in the filter
+    dynamic_bloom_filter<std::uint64_t> halves (num_bits, num_hash_fns);
+    halves.build(values.begin(), values.begin() + num_values / 2, 2);
+    halves.build(values.begin() + num_values / 2, values.end(), 3);
+    if (halves != expected)
+    {
+        std::cerr << "Filter built in two parts differs!\n";
+        return 1;
+    }
+
+    // any forward range works, and double hashing too
+    std::list<std::string> words;
+    for (size_t i = 0; i < 10000; ++i) words.push_back("word " + std::to_string(i));
+    dynamic_bloom_filter<std::string, double_hashing> one_by_one (100000, 5);
+    for (auto const& w : words) one_by_one.add(w);
+    dynamic_bloom_filter<std::string, double_hashing> strings (100000, 5);
+    strings.build(words.begin(), words.end(), 4);
+    if (strings != one_by_one)
+    {
+        std::cerr << "String filter built with threads differs!\n";
+        return 1;
+    }
+
+    // an empty range changes nothing
+    dynamic_bloom_filter<std::string, double_hashing> empty (100000, 5);
+    empty.build(words.end(), words.end(), 4);
+    if (empty != dynamic_bloom_filter<std::string, double_hashing>(100000, 5))
+    {
+        std::cerr << "Empty range set bits!\n";
+        return 1;
+    }
+
+    // an exception of any thread reaches the caller, and no thread is left
+    // waiting at a barrier
+    std::vector<std::uint64_t> poisoned (values);
+    poisoned[3 * num_values / 4] = throwing_hasher::poison;
+    for (size_t const threads : { 1, 2, 4 })
+    {
+        dynamic_bloom_filter<std::uint64_t, independent_hashing, throwing_hasher> failing (
+                num_bits, num_hash_fns);
+        try
+        {
+            failing.build(poisoned.begin(), poisoned.end(), threads);
+            std::cerr << "Build with " << threads << " threads swallowed an exception!\n";
+            return 1;
+        }
+        catch (std::runtime_error const&) {}
+    }
+
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../lib/bloom_filter"
+
+int main()
+{
+    constexpr size_t const num_hash_fns    = 7;
+    constexpr size_t const num_threads     = 8;
+    constexpr size_t const items_per_thread { 50000 };
+    constexpr size_t const num_bits        = 10 * num_threads * items_per_thread;
+
+    concurrent_bloom_filter<size_t> filter (num_bits, num_hash_fns);
+
+    // values inserted before the writers start must be seen by the readers
+    // the whole time
+    constexpr size_t const num_preloaded = 1000;
+    for (size_t i = 0; i < num_preloaded; ++i)
+    {
+        filter.add(~i);
+    }
+
+    std::atomic<bool> writers_done { false };
+    std::atomic<bool> reader_failed { false };
+    std::thread reader ([&]
+        {
+            while (not writers_done.load())
+            {
+                for (size_t i = 0; i < num_preloaded; ++i)
+                {
+                    if (not filter.test(~i)) reader_failed = true;
+                }
+            }
+        });
+
+    // every writer inserts its own range of values
+    std::vector<std::thread> writers;
+    for (size_t t = 0; t < num_threads; ++t)
+    {
+        writers.emplace_back([&filter, t]
+            {
+                for (size_t i = t * items_per_thread; i < (t + 1) * items_per_thread; ++i)
+                {
+                    filter.add(i);
+                }
+            });
+    }
+    for (auto& w : writers) w.join();
+    writers_done = true;
+    reader.join();
+
+    if (reader_failed)
+    {
+        std::cerr << "Concurrent reader got false negative for a preloaded value!\n";
+        return 1;
+    }
+
+    // after joining, all inserts of all writers are visible
+    for (size_t i = 0; i < num_threads * items_per_thread; ++i)
+    {
+        if (not filter.test(i))
+        {
+            std::cerr << "Tested for membership of value and got false negative!\n";
+            return 1;
+        }
+    }
+}
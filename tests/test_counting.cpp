@@ -0,0 +1,78 @@
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "../lib/bloom_filter"
+
+int main()
+{
+    constexpr size_t const num_hash_fns   = 7;
+    constexpr size_t const num_counters   = 1000000;
+    constexpr size_t const num_test_items { 100000 };
+
+    // counters saturate instead of wrapping around
+    detail::counter_array counters (40);
+    for (size_t i = 0; i < 20; ++i) counters.increment(17);
+    counters.increment(18);
+    counters.decrement(17);
+    counters.decrement(18);
+    counters.decrement(18);
+    if (counters.count(17) != detail::counter_array::max_count or counters.count(18) != 0
+            or counters.count(16) != 0 or counters.count(19) != 0)
+    {
+        std::cerr << "Counters do not saturate or leak into their neighbours!\n";
+        return 1;
+    }
+
+    counting_bloom_filter<std::uint64_t> filter (num_counters, num_hash_fns);
+    for (std::uint64_t i = 0; i < num_test_items; ++i) filter.add(i);
+
+    // remove the even values, the odd ones must stay
+    for (std::uint64_t i = 0; i < num_test_items; i += 2)
+    {
+        if (not filter.remove(i))
+        {
+            std::cerr << "Could not remove a value that was added!\n";
+            return 1;
+        }
+    }
+    size_t still_positive = 0;
+    for (std::uint64_t i = 0; i < num_test_items; ++i)
+    {
+        bool const member = filter.test(i);
+        if (i % 2 == 1 and not member)
+        {
+            std::cerr << "Tested for membership of value and got false negative!\n";
+            return 1;
+        }
+        if (i % 2 == 0) still_positive += member;
+    }
+
+    // removed values are false positives at the rate of a half full filter
+    if (still_positive > num_test_items / 2 / 100)
+    {
+        std::cerr << "Too many removed values still test positive!\n";
+        return 1;
+    }
+
+    // after removing everything, nothing is left
+    for (std::uint64_t i = 1; i < num_test_items; i += 2) filter.remove(i);
+    for (std::uint64_t i = 0; i < num_test_items; ++i)
+    {
+        if (filter.test(i))
+        {
+            std::cerr << "Value still tests positive in an empty filter!\n";
+            return 1;
+        }
+    }
+
+    counting_bloom_filter<std::string, double_hashing> strings (10000, 5);
+    strings.add("sliding");
+    strings.add("window");
+    strings.remove("sliding");
+    if (strings.test("sliding") or not strings.test("window") or strings.remove("absent"))
+    {
+        std::cerr << "String filter does not remove values correctly!\n";
+        return 1;
+    }
+}
@@ -0,0 +1,137 @@
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "../lib/bloom_filter"
+
+struct S
+{
+    std::string s;
+    int i;
+};
+
+// must provide a hash function, as for bloom_filter
+namespace std
+{
+    template<>
+    struct hash<S>
+    {
+        size_t operator()(S const& arg) const noexcept
+        {
+            return std::hash<std::string>{}(arg.s) ^ std::hash<int>{}(arg.i);
+        }
+    };
+}
+
+/**
+ * Fill a filter to its capacity, then check members, false positive rate,
+ * removal and what happens when it overflows.
+ */
+template<size_t fingerprint_bits>
+bool check(double const max_fpr)
+{
+    constexpr size_t const capacity = 100000;
+    cuckoo_filter<std::uint64_t, fingerprint_bits> filter (capacity);
+
+    for (std::uint64_t i = 0; i < capacity; ++i)
+    {
+        if (not filter.add(i))
+        {
+            std::cerr << "Filter is full below its capacity!\n";
+            return false;
+        }
+    }
+    for (std::uint64_t i = 0; i < capacity; ++i)
+    {
+        if (not filter.test(i))
+        {
+            std::cerr << "Tested for membership of value and got false negative!\n";
+            return false;
+        }
+    }
+
+    size_t false_positives = 0;
+    for (std::uint64_t i = capacity; i < 11 * capacity; ++i) false_positives += filter.test(i);
+    double const fpr = static_cast<double>(false_positives) / (10 * capacity);
+    if (fpr > max_fpr)
+    {
+        std::cerr << fingerprint_bits << " bit fingerprints have a false positive rate of " << fpr << "!\n";
+        return false;
+    }
+
+    // removed values are gone, the others stay
+    for (std::uint64_t i = 0; i < capacity; i += 2) filter.remove(i);
+    size_t still_positive = 0;
+    for (std::uint64_t i = 0; i < capacity; ++i)
+    {
+        if (i % 2 == 1 and not filter.test(i))
+        {
+            std::cerr << "Removal caused a false negative!\n";
+            return false;
+        }
+        if (i % 2 == 0) still_positive += filter.test(i);
+    }
+    if (still_positive > 2 * max_fpr * capacity)
+    {
+        std::cerr << "Removed values still test positive!\n";
+        return false;
+    }
+
+    // overfill: add reports the value was not added and leaves the filter
+    // unchanged, so no value added before is lost
+    std::uint64_t next = 11 * capacity;
+    std::uint64_t const first = next;
+    size_t full_size = filter.size();
+    while (filter.add(next))
+    {
+        ++next;
+        full_size = filter.size();
+    }
+    if (filter.size() != full_size)
+    {
+        std::cerr << "Failed add changed the filter!\n";
+        return false;
+    }
+    for (std::uint64_t i = first; i < next; ++i)
+    {
+        if (not filter.test(i))
+        {
+            std::cerr << "Value added before the filter got full is lost!\n";
+            return false;
+        }
+    }
+    if (filter.load_factor() < 0.9)
+    {
+        std::cerr << "Filter got full at a load factor of " << filter.load_factor() << "!\n";
+        return false;
+    }
+    return true;
+}
+
+int main()
+{
+    if (not check<8>(0.04)) return 1;
+    if (not check<12>(0.003)) return 1;
+    if (not check<16>(0.0002)) return 1;
+
+    // user types work as for bloom_filter
+    std::array<S, 4> const members = {{ {"rayleigh", 12392}, {"campaign", -16758},
+        {"none", -10388}, {"ibilltes", 9002} }};
+    cuckoo_filter<S, 16> structs (100);
+    for (auto const& s : members) structs.add(s);
+    for (auto const& s : members)
+    {
+        if (not structs.test(s))
+        {
+            std::cerr << "Tested for membership of struct and got false negative!\n";
+            return 1;
+        }
+    }
+    structs.remove(members[0]);
+    if (structs.test(members[0]) or structs.size() != members.size() - 1)
+    {
+        std::cerr << "Struct was not removed!\n";
+        return 1;
+    }
+}
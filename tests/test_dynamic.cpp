@@ -0,0 +1,82 @@
+#include <set>
+#include <random>
+#include <iostream>
+#include <vector>
+
+#include "../lib/bloom_filter"
+
+int main()
+{
+    constexpr size_t const num_hash_fns = 7;
+    constexpr size_t const num_bits     = 958506; // not a power of two
+
+    constexpr size_t const num_test_items { 100000 };
+    std::default_random_engine generator;
+    std::uniform_int_distribution<int> dist (
+            std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+
+    for (bool const huge_pages : { false, true })
+    {
+        std::set<int> integers;
+        dynamic_bloom_filter<int> filter (num_bits, num_hash_fns, huge_pages);
+        if (filter.num_bits() != num_bits or filter.num_hash_functions() != num_hash_fns)
+        {
+            std::cerr << "Filter does not report the parameters it was built with!\n";
+            return 1;
+        }
+
+        for (size_t i = 0; i < num_test_items; ++i)
+        {
+            auto const x = dist(generator);
+            integers.insert(x);
+            filter.add(x);
+        }
+
+        // check true positives
+        for (auto& i : integers)
+        {
+            if (not filter.test(i))
+            {
+                std::cerr << "Tested for membership of value and got false negative!\n";
+                return 1;
+            }
+        }
+
+        // the batch interface must agree with the single value interface,
+        // for members and (mostly) non-members alike
+        std::vector<int> values (integers.begin(), integers.end());
+        for (size_t i = 0; i < num_test_items; ++i) values.push_back(dist(generator));
+
+        dynamic_bloom_filter<int> batch_filter (num_bits, num_hash_fns, huge_pages);
+        batch_filter.add_batch(values.data(), integers.size());
+
+        std::vector<std::uint64_t> results ((values.size() + 63) / 64);
+        batch_filter.test_batch(values.data(), values.size(), results.data());
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            bool const batch_result = (results[i / 64] >> (i % 64)) & 1u;
+            if (batch_result != filter.test(values[i]))
+            {
+                std::cerr << "Batch and single value interface disagree!\n";
+                return 1;
+            }
+        }
+    }
+
+    // more hash functions than fit the batch window's inline buffer
+    dynamic_bloom_filter<int> many (num_bits, 20);
+    std::vector<int> values;
+    for (size_t i = 0; i < 1000; ++i) values.push_back(dist(generator));
+    many.add_batch(values.data(), values.size() / 2);
+    std::vector<std::uint64_t> results ((values.size() + 63) / 64);
+    many.test_batch(values.data(), values.size(), results.data());
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        bool const batch_result = (results[i / 64] >> (i % 64)) & 1u;
+        if (batch_result != many.test(values[i]) or (i < values.size() / 2 and not batch_result))
+        {
+            std::cerr << "Batch interface with many hash functions is wrong!\n";
+            return 1;
+        }
+    }
+}
@@ -0,0 +1,105 @@
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../lib/bloom_filter"
+
+/**
+ * Check that every bit counting kernel the CPU supports counts the same as
+ * the scalar one, for lengths that leave a tail after the vector loop.
+ */
+bool check_kernels()
+{
+    std::vector<detail::words::count_fn> kernels { detail::words::select_popcount() };
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("popcnt")) kernels.push_back(detail::words::popcount_popcnt);
+    if (__builtin_cpu_supports("avx2")) kernels.push_back(detail::words::popcount_avx2);
+    if (__builtin_cpu_supports("avx512bw")) kernels.push_back(detail::words::popcount_avx512);
+#endif
+
+    std::default_random_engine generator;
+    std::uniform_int_distribution<std::uint64_t> dist;
+    for (size_t const count : { 0, 1, 3, 7, 8, 9, 63, 64, 1000 })
+    {
+        std::vector<std::uint64_t> words (count);
+        for (auto& word : words) word = dist(generator);
+        if (count > 0) words[0] = ~std::uint64_t{0};
+
+        size_t const expected = detail::words::popcount_scalar(words.data(), count);
+        for (auto const kernel : kernels)
+        {
+            if (kernel(words.data(), count) != expected) return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    if (not check_kernels())
+    {
+        std::cerr << "Bit counting kernels disagree with the scalar one!\n";
+        return 1;
+    }
+
+    constexpr size_t const num_values = 100000;
+    dynamic_bloom_filter<std::uint64_t> filter (optimal_parameters(num_values, 0.01));
+    if (filter.num_set_bits() != 0 or filter.fill_ratio() != 0
+        or filter.estimated_size() != 0 or filter.estimated_false_positive_rate() != 0)
+    {
+        std::cerr << "Empty filter is not empty!\n";
+        return 1;
+    }
+
+    // values added twice count once
+    for (std::uint64_t i = 0; i < num_values; ++i)
+    {
+        filter.add(i);
+        filter.add(i);
+    }
+    double const size = filter.estimated_size();
+    if (std::abs(size - num_values) > 0.02 * num_values)
+    {
+        std::cerr << "Estimated " << size << " values instead of " << num_values << "!\n";
+        return 1;
+    }
+    if (std::abs(filter.fill_ratio() - 0.5) > 0.02)
+    {
+        std::cerr << "Filter sized for its values is " << filter.fill_ratio() << " full!\n";
+        return 1;
+    }
+
+    size_t false_positives = 0;
+    constexpr size_t const num_probes = 1000000;
+    for (std::uint64_t i = 0; i < num_probes; ++i) false_positives += filter.test(num_values + i);
+    double const measured = static_cast<double>(false_positives) / num_probes;
+    double const estimated = filter.estimated_false_positive_rate();
+    if (std::abs(measured - estimated) > 0.1 * estimated)
+    {
+        std::cerr << "Estimated a false positive rate of " << estimated
+                  << ", measured " << measured << "!\n";
+        return 1;
+    }
+
+    // the estimates show when a filter is overfilled
+    for (std::uint64_t i = num_values; i < 4 * num_values; ++i) filter.add(i);
+    if (std::abs(filter.estimated_size() - 4 * num_values) > 0.02 * 4 * num_values
+        or filter.estimated_false_positive_rate() < 0.2)
+    {
+        std::cerr << "Estimates miss that the filter is overfilled!\n";
+        return 1;
+    }
+
+    dynamic_bloom_filter<int> full (100, 2);
+    for (int i = 0; i < 10000; ++i) full.add(i);
+    if (full.num_set_bits() != 100 or full.fill_ratio() != 1
+        or not std::isinf(full.estimated_size()) or full.estimated_false_positive_rate() != 1)
+    {
+        std::cerr << "Estimates of a full filter are wrong!\n";
+        return 1;
+    }
+
+    return 0;
+}
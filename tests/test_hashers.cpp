@@ -0,0 +1,68 @@
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "../lib/bloom_filter"
+
+/**
+ * Fraction of false positives when probing the next num_probes integers after
+ * num_items sequential integer keys.
+ */
+template<typename hasher>
+double sequential_fpr(size_t const num_items, size_t const num_probes)
+{
+    dynamic_bloom_filter<size_t, independent_hashing, hasher> filter (10 * num_items, 7);
+    for (size_t i = 0; i < num_items; ++i)
+    {
+        filter.add(i);
+    }
+
+    size_t false_positives = 0;
+    for (size_t i = num_items; i < num_items + num_probes; ++i)
+    {
+        if (filter.test(i)) ++false_positives;
+    }
+    return static_cast<double>(false_positives) / num_probes;
+}
+
+int main()
+{
+    wyhash_hasher const wy;
+
+    // hashes depend on the seed and are stable
+    std::string const s { "a string longer than sixteen bytes, to take the long path" };
+    if (wy(s, 1) == wy(s, 2) or wy(s, 1) != wy(s, 1))
+    {
+        std::cerr << "String hash does not depend on seed correctly!\n";
+        return 1;
+    }
+    if (wy(42, 1) == wy(42, 2) or wy(42, 1) == wy(43, 1))
+    {
+        std::cerr << "Integer hash does not depend on seed and value!\n";
+        return 1;
+    }
+
+    // the same bytes hash the same whether held in a string or a view
+    if (wy(s, 7) != wy(std::string_view(s), 7))
+    {
+        std::cerr << "std::string and std::string_view hash differently!\n";
+        return 1;
+    }
+
+    // both halves of the 128-bit hash differ
+    auto const pair = wy.hash128(s, 7);
+    if (pair.h1 == pair.h2)
+    {
+        std::cerr << "Halves of the 128-bit hash are equal!\n";
+        return 1;
+    }
+
+    // sequential integer keys at 10 bits per key and 7 hash functions should
+    // stay close to the theoretical false positive rate of about 0.8%
+    double const fpr = sequential_fpr<wyhash_hasher>(100000, 100000);
+    if (fpr > 0.0125)
+    {
+        std::cerr << "False positive rate " << fpr << " for sequential keys is too high!\n";
+        return 1;
+    }
+}
@@ -0,0 +1,125 @@
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../lib/bloom_filter"
+
+/**
+ * Add strings through every kind of key and check that all kinds of keys
+ * then give the same answers as the strings themselves.
+ */
+template<typename hashing, typename hasher>
+bool check()
+{
+    constexpr size_t const num_values = 10000;
+    std::vector<std::string> values;
+    for (size_t i = 0; i < 2 * num_values; ++i) values.push_back("value " + std::to_string(i));
+
+    dynamic_bloom_filter<std::string, hashing, hasher> reference (95851, 7);
+    dynamic_bloom_filter<std::string, hashing, hasher> filter (95851, 7);
+    for (size_t i = 0; i < num_values; ++i)
+    {
+        reference.add(values[i]);
+        std::string_view const view (values[i]);
+        switch (i % 3)
+        {
+            case 0: filter.add(view); break;
+            case 1: filter.add(values[i].c_str()); break;
+            default: filter.add(view.data(), view.size()); break;
+        }
+    }
+    if (filter != reference)
+    {
+        std::cerr << "Adding keys sets other bits than adding the strings!\n";
+        return false;
+    }
+
+    std::vector<std::string_view> views (values.begin(), values.end());
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        bool const expected = reference.test(values[i]);
+        if (filter.test(views[i]) != expected
+            or filter.test(values[i].c_str()) != expected
+            or filter.test(views[i].data(), views[i].size()) != expected)
+        {
+            std::cerr << "Key is tested differently than the equal string!\n";
+            return false;
+        }
+    }
+
+    dynamic_bloom_filter<std::string, hashing, hasher> batched (95851, 7);
+    batched.add_batch(views.data(), num_values);
+    if (batched != reference)
+    {
+        std::cerr << "Batch of keys sets other bits than the strings!\n";
+        return false;
+    }
+    std::vector<std::uint64_t> results ((views.size() + 63) / 64);
+    filter.test_batch(views.data(), views.size(), results.data());
+    for (size_t i = 0; i < views.size(); ++i)
+    {
+        if (((results[i / 64] >> (i % 64)) & 1) != reference.test(values[i]))
+        {
+            std::cerr << "Batch test of keys differs from single tests!\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    if (not check<independent_hashing, wyhash_hasher>()) return 1;
+    if (not check<independent_hashing, std_hasher>()) return 1;
+    if (not check<double_hashing, wyhash_hasher>()) return 1;
+    if (not check<double_hashing, std_hasher>()) return 1;
+
+    // std_hasher still hashes like salted_type, so saved filters stay valid
+    std::string const word = "word";
+    for (std::uint64_t const salt : { 0u, 1u, 12345u })
+    {
+        auto const expected = std::hash<salted_type<std::string>>{}(salted_type<std::string>{ word, salt });
+        if (std_hasher{}(word, salt) != expected * detail::multiply_shift_constant
+            or std_hasher{}(std::string_view(word), salt) != std_hasher{}(word, salt))
+        {
+            std::cerr << "std_hasher changed its hash values!\n";
+            return 1;
+        }
+    }
+
+    // compile-time and mapped filters take keys too
+    bloom_filter<std::string, 3, 10> fixed;
+    fixed.add(std::string_view("alpha"));
+    if (not fixed.test(std::string("alpha")) or not fixed.test("alpha"))
+    {
+        std::cerr << "Compile-time filter misses a key!\n";
+        return 1;
+    }
+
+    std::string const path = "test_heterogeneous.bloom";
+    dynamic_bloom_filter<std::string> saved (1000, 3);
+    saved.add("beta");
+    {
+        std::ofstream file (path, std::ios::binary);
+        saved.save(file);
+    }
+    {
+        mapped_bloom_filter<std::string> mapped (path);
+        std::string_view const keys[] = { "beta", "gamma" };
+        std::uint64_t result = 0;
+        mapped.test_batch(keys, 2, &result);
+        if (not mapped.test(std::string_view("beta")) or (result & 1) == 0
+            or (result & 2) != (saved.test("gamma") ? 2u : 0u))
+        {
+            std::cerr << "Mapped filter tests keys differently!\n";
+            return 1;
+        }
+    }
+    std::remove(path.c_str());
+
+    return 0;
+}
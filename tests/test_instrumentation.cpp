@@ -0,0 +1,105 @@
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../lib/bloom_filter"
+
+/**
+ * The members of a filter without instrumentation.
+ */
+struct uninstrumented
+{
+    detail::index_generator<int, independent_hashing, wyhash_hasher> indices;
+    detail::bit_array bits;
+};
+
+int main()
+{
+    // the default policy takes no space
+    static_assert(sizeof(dynamic_bloom_filter<int>) == sizeof(uninstrumented),
+            "no_instrumentation changes the size of filters");
+
+    using counted_filter = dynamic_bloom_filter<std::uint64_t, independent_hashing,
+          wyhash_hasher, counting_instrumentation>;
+    constexpr size_t const num_values = 100000;
+    counted_filter filter (optimal_parameters(num_values, 0.01));
+
+    std::vector<std::uint64_t> values;
+    for (std::uint64_t i = 0; i < num_values; ++i) values.push_back(i);
+    for (size_t i = 0; i < num_values / 2; ++i) filter.add(values[i]);
+    filter.add_batch(values.data() + num_values / 2, num_values / 4);
+    filter.build(values.begin() + 3 * num_values / 4, values.end(), 2);
+
+    auto counts = filter.statistics();
+    if (counts.adds != num_values or counts.tests != 0 or counts.batches != 2)
+    {
+        std::cerr << "Counted " << counts.adds << " adds in " << counts.batches << " batches!\n";
+        return 1;
+    }
+
+    // threads testing the same filter count into their own shards
+    constexpr size_t const num_threads = 4;
+    constexpr size_t const num_probes = 200000;
+    std::vector<std::thread> threads;
+    std::vector<size_t> positives (num_threads);
+    for (size_t t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([&, t]
+        {
+            for (std::uint64_t i = 0; i < num_probes; ++i)
+                positives[t] += filter.test(num_values + t * num_probes + i);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    size_t expected_positives = 0;
+    for (auto const p : positives) expected_positives += p;
+    counts = filter.statistics();
+    if (counts.tests != num_threads * num_probes or counts.positives != expected_positives)
+    {
+        std::cerr << "Lost tests of concurrent threads!\n";
+        return 1;
+    }
+    if (std::abs(counts.positive_rate() - filter.estimated_false_positive_rate()) > 0.002)
+    {
+        std::cerr << "Observed a positive rate of " << counts.positive_rate() << " instead of "
+                  << filter.estimated_false_positive_rate() << "!\n";
+        return 1;
+    }
+
+    // batch tests count their positives
+    filter.reset_statistics();
+    std::vector<std::uint64_t> results ((num_values + 63) / 64);
+    filter.test_batch(values.data(), num_values, results.data());
+    counts = filter.statistics();
+    if (counts.tests != num_values or counts.positives != num_values or counts.batches != 1)
+    {
+        std::cerr << "Batch test was counted wrong!\n";
+        return 1;
+    }
+
+    // copies take the counts along
+    counted_filter const copy = filter;
+    if (copy.statistics().tests != num_values or copy.statistics().positives != num_values)
+    {
+        std::cerr << "Copy lost the counts!\n";
+        return 1;
+    }
+
+    // compile-time filters and heterogeneous keys are counted too
+    bloom_filter<std::string, 3, 10, independent_hashing, wyhash_hasher, counting_instrumentation> words;
+    words.add("alpha");
+    words.add(std::string_view("beta"));
+    bool const found = words.test(std::string("alpha"));
+    if (not found or words.statistics().adds != 2 or words.statistics().positives != 1)
+    {
+        std::cerr << "Compile-time filter was counted wrong!\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+
+#include "../lib/bloom_filter"
+
+// the factory is usable at compile time
+constexpr auto const compile_time = optimal_parameters(1000000, 0.01);
+static_assert(compile_time.num_hash_functions == 7, "1% needs 7 hash functions");
+static_assert(compile_time.num_bits > 9500000 and compile_time.num_bits < 9700000,
+        "1% needs about 9.6 bits per value");
+
+int main()
+{
+    // matches the closed form up to the rounding of k
+    for (double const p : { 0.5, 0.1, 0.01, 0.001, 1e-6 })
+    {
+        for (size_t const n : { 1ul, 1000ul, 1000000ul, 1000000000ul })
+        {
+            auto const params = optimal_parameters(n, p);
+            double const m = -static_cast<double>(n) * std::log(p) / (std::log(2) * std::log(2));
+            if (params.num_bits < m or params.num_bits > 1.05 * m + 1)
+            {
+                std::cerr << "Number of bits is not optimal for n = " << n << ", p = " << p << "\n";
+                return 1;
+            }
+            double const k = static_cast<double>(params.num_hash_functions);
+            double const fpr = std::pow(1 - std::exp(-k * n / params.num_bits), k);
+            if (fpr > p * (1 + 1e-9))
+            {
+                std::cerr << "Parameters miss the target for n = " << n << ", p = " << p << "\n";
+                return 1;
+            }
+        }
+    }
+
+    // a filter sized by the factory reaches the target
+    constexpr size_t const n = 200000;
+    constexpr double const p = 0.01;
+    dynamic_bloom_filter<std::uint64_t> filter (optimal_parameters(n, p));
+    for (std::uint64_t i = 0; i < n; ++i) filter.add(i);
+    size_t false_positives = 0;
+    for (std::uint64_t i = n; i < 2 * n; ++i) false_positives += filter.test(i);
+    if (false_positives > 1.2 * p * n)
+    {
+        std::cerr << "Filter sized for 1% has a false positive rate of "
+            << static_cast<double>(false_positives) / n << "!\n";
+        return 1;
+    }
+
+    // and so does one sized at compile time
+    constexpr auto params = optimal_parameters(n, p);
+    sized_bloom_filter<std::uint64_t, params.num_bits, params.num_hash_functions> sized;
+    if (sized.num_bits() != params.num_bits or sized.num_hash_functions() != params.num_hash_functions)
+    {
+        std::cerr << "Sized filter does not have the requested parameters!\n";
+        return 1;
+    }
+
+    try
+    {
+        optimal_parameters(n, 1.5);
+        std::cerr << "Accepted a false positive rate above 1!\n";
+        return 1;
+    }
+    catch (std::invalid_argument const&) {}
+}
@@ -0,0 +1,151 @@
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../lib/bloom_filter"
+
+/**
+ * Hasher that fails for one value, as a user hasher might.
+ */
+struct throwing_hasher
+{
+    static constexpr std::uint64_t const poison = 12345;
+
+    std::uint64_t operator()(std::uint64_t const value, std::uint64_t const seed) const
+    {
+        if (value == poison) throw std::runtime_error("can not hash the poison value");
+        return wyhash_hasher{}(value, seed);
+    }
+};
+
+/**
+ * Build a partitioned filter in every way and check members, the false
+ * positive rate against a plain filter, and batch tests with any number of
+ * threads.
+ */
+template<typename hashing>
+bool check(size_t const num_shards)
+{
+    constexpr size_t const num_values = 200000;
+    constexpr size_t const num_bits = 1917012;
+    constexpr size_t const num_hash_fns = 7;
+
+    std::vector<std::uint64_t> values;
+    for (std::uint64_t i = 0; i < 2 * num_values; ++i) values.push_back(i * 7919);
+
+    partitioned_bloom_filter<std::uint64_t, hashing> added (num_bits, num_hash_fns, num_shards);
+    partitioned_bloom_filter<std::uint64_t, hashing> built (num_bits, num_hash_fns, num_shards);
+    partitioned_bloom_filter<std::uint64_t, hashing> built_alone (num_bits, num_hash_fns, num_shards);
+    for (size_t i = 0; i < num_values; ++i) added.add(values[i]);
+    built.build(values.begin(), values.begin() + num_values);
+    built_alone.build(values.begin(), values.begin() + num_values, 1);
+
+    if (built.num_shards() != num_shards or built.num_bits() < num_bits
+        or built.num_hash_functions() != num_hash_fns)
+    {
+        std::cerr << "Partitioned filter has wrong parameters!\n";
+        return false;
+    }
+
+    dynamic_bloom_filter<std::uint64_t, hashing> plain (num_bits, num_hash_fns);
+    plain.build(values.begin(), values.begin() + num_values);
+    size_t false_positives = 0;
+    size_t plain_false_positives = 0;
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        bool const expected = added.test(values[i]);
+        if (i < num_values and not expected)
+        {
+            std::cerr << "Tested for membership of value and got false negative!\n";
+            return false;
+        }
+        if (built.test(values[i]) != expected or built_alone.test(values[i]) != expected)
+        {
+            std::cerr << "Built filter differs from the one added to!\n";
+            return false;
+        }
+        if (i >= num_values)
+        {
+            false_positives += expected;
+            plain_false_positives += plain.test(values[i]);
+        }
+    }
+    if (false_positives > 1.2 * plain_false_positives + 50)
+    {
+        std::cerr << "Partitioned filter has " << false_positives << " false positives, a plain one "
+                  << plain_false_positives << "!\n";
+        return false;
+    }
+
+    for (size_t const num_threads : { 1, 2, 16 })
+    {
+        std::vector<std::uint64_t> results ((values.size() + 63) / 64);
+        built.test_batch(values.data(), values.size(), results.data(), num_threads);
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            if (((results[i / 64] >> (i % 64)) & 1) != built.test(values[i]))
+            {
+                std::cerr << "Batch test with " << num_threads << " threads differs from single tests!\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    if (detail::numa::parse_list("0-3,8,10-11\n") != std::vector<int>{ 0, 1, 2, 3, 8, 10, 11 })
+    {
+        std::cerr << "Parsed a CPU list wrong!\n";
+        return 1;
+    }
+    auto const& nodes = detail::numa::nodes();
+    if (nodes.empty())
+    {
+        std::cerr << "Found no NUMA node!\n";
+        return 1;
+    }
+
+    for (size_t const num_shards : { size_t{1}, size_t{3}, nodes.size() * 4 })
+    {
+        if (not check<independent_hashing>(num_shards)) return 1;
+        if (not check<double_hashing>(num_shards)) return 1;
+    }
+
+    // the default is at least one shard per node, spread evenly
+    partitioned_bloom_filter<std::string> strings (100000, 5);
+    if (strings.num_shards() % nodes.size() != 0
+        or strings.shard_node(0) != nodes.front().id
+        or strings.shard_node(strings.num_shards() - 1) != nodes.back().id)
+    {
+        std::cerr << "Shards are not spread over the nodes!\n";
+        return 1;
+    }
+    strings.add("alpha");
+    if (not strings.test("alpha"))
+    {
+        std::cerr << "Tested for membership of string and got false negative!\n";
+        return 1;
+    }
+
+    // an exception of any routing thread reaches the caller
+    std::vector<std::uint64_t> poisoned;
+    for (std::uint64_t i = 0; i < 100000; ++i) poisoned.push_back(i * 7919 + 1);
+    poisoned[75000] = throwing_hasher::poison;
+    partitioned_bloom_filter<std::uint64_t, independent_hashing, throwing_hasher> failing (1 << 20, 7, 4);
+    for (size_t const num_threads : { 1, 4 })
+    {
+        try
+        {
+            failing.build(poisoned.begin(), poisoned.end(), num_threads);
+            std::cerr << "Build with " << num_threads << " threads swallowed an exception!\n";
+            return 1;
+        }
+        catch (std::runtime_error const&) {}
+    }
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "../lib/bloom_filter"
+
+int main()
+{
+    constexpr size_t const initial_capacity = 1000;
+    constexpr double const fpr = 0.01;
+    constexpr size_t const num_test_items = 100000;
+
+    scalable_bloom_filter<std::uint64_t> filter (initial_capacity, fpr);
+    for (std::uint64_t i = 0; i < num_test_items; ++i) filter.add(i);
+
+    // 1000 + 2000 + ... + 64000 < 100000 <= 1000 + ... + 128000
+    if (filter.size() != num_test_items or filter.num_stages() != 7
+            or filter.capacity() < num_test_items)
+    {
+        std::cerr << "Filter did not grow as expected, it has "
+            << filter.num_stages() << " stages!\n";
+        return 1;
+    }
+    if (filter.fpr_bound() > fpr)
+    {
+        std::cerr << "False positive rate bound exceeds the target!\n";
+        return 1;
+    }
+
+    for (std::uint64_t i = 0; i < num_test_items; ++i)
+    {
+        if (not filter.test(i))
+        {
+            std::cerr << "Tested for membership of value and got false negative!\n";
+            return 1;
+        }
+    }
+
+    // 100 times the initial capacity, and the rate still stays in bounds;
+    // the bound holds in expectation, so allow for the variance of the small
+    // early stages
+    size_t false_positives = 0;
+    for (std::uint64_t i = num_test_items; i < 11 * num_test_items; ++i)
+    {
+        false_positives += filter.test(i);
+    }
+    double const measured = static_cast<double>(false_positives) / (10 * num_test_items);
+    if (measured > 1.2 * fpr)
+    {
+        std::cerr << "False positive rate " << measured << " exceeds the target!\n";
+        return 1;
+    }
+
+    scalable_bloom_filter<std::string, double_hashing> strings (16, 0.001, 4, 0.8);
+    for (size_t i = 0; i < 10000; ++i) strings.add("value " + std::to_string(i));
+    for (size_t i = 0; i < 10000; ++i)
+    {
+        if (not strings.test("value " + std::to_string(i)))
+        {
+            std::cerr << "Tested for membership of string and got false negative!\n";
+            return 1;
+        }
+    }
+
+    // a next stage too large for size_t is refused, not truncated
+    scalable_bloom_filter<int> huge (1, 0.01, 1e30);
+    huge.add(0);
+    try
+    {
+        huge.add(1);
+        std::cerr << "Appended a stage whose capacity overflows!\n";
+        return 1;
+    }
+    catch (std::length_error const&) {}
+    if (huge.size() != 1 or not huge.test(0))
+    {
+        std::cerr << "Refused stage changed the filter!\n";
+        return 1;
+    }
+}
@@ -0,0 +1,82 @@
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "../lib/bloom_filter"
+
+int main()
+{
+    // the salt derivation is pinned to the published SplitMix64 outputs,
+    // so filters stay compatible across platforms and releases
+    std::uint64_t state = 0;
+    std::vector<std::uint64_t> const expected {
+        0xe220a8397b1dcdafull, 0x6e789e6aa1b965f4ull, 0x06c45d188009454full
+    };
+    for (auto const e : expected)
+    {
+        if (detail::splitmix64(state) != e)
+        {
+            std::cerr << "SplitMix64 does not match its reference output!\n";
+            return 1;
+        }
+    }
+
+    constexpr size_t const num_hash_fns = 7;
+    constexpr size_t const num_bits     = 958506;
+
+    dynamic_bloom_filter<int> unseeded (num_bits, num_hash_fns);
+    dynamic_bloom_filter<int> zero (num_bits, num_hash_fns, filter_seed{0});
+    dynamic_bloom_filter<int> seeded (num_bits, num_hash_fns, filter_seed{42});
+    dynamic_bloom_filter<int> same (optimal_parameters(100000, 0.01), filter_seed{42});
+    if (unseeded.salts() != zero.salts())
+    {
+        std::cerr << "Filters without a seed do not use seed 0!\n";
+        return 1;
+    }
+    if (seeded.salts() == zero.salts() or seeded.salts().size() != num_hash_fns)
+    {
+        std::cerr << "Seed does not determine the salts!\n";
+        return 1;
+    }
+    state = 42;
+    if (same.salts().front() != detail::splitmix64(state))
+    {
+        std::cerr << "Salts are not derived with SplitMix64!\n";
+        return 1;
+    }
+
+    bloom_filter<int, 4, 10, double_hashing> compile_time (filter_seed{42});
+    dynamic_bloom_filter<int, double_hashing> runtime (1 << 10, 4, filter_seed{42});
+    if (compile_time.salts() != runtime.salts() or runtime.salts().size() != 1)
+    {
+        std::cerr << "Compile-time and runtime filters with a seed differ!\n";
+        return 1;
+    }
+
+    // filters built separately with one seed merge into the filter of all
+    // values, also after a round trip through a file
+    dynamic_bloom_filter<int> whole (num_bits, num_hash_fns, filter_seed{7});
+    dynamic_bloom_filter<int> left (num_bits, num_hash_fns, filter_seed{7});
+    dynamic_bloom_filter<int> right (num_bits, num_hash_fns, filter_seed{7});
+    for (int i = 0; i < 100000; ++i)
+    {
+        whole.add(i);
+        (i % 2 == 0 ? left : right).add(i);
+    }
+    std::stringstream stream;
+    right.save(stream);
+    left |= dynamic_bloom_filter<int>::load(stream);
+    if (left != whole)
+    {
+        std::cerr << "Filters with the same seed do not merge!\n";
+        return 1;
+    }
+    if (seeded.compatible(whole))
+    {
+        std::cerr << "Filters with different seeds are compatible!\n";
+        return 1;
+    }
+
+    return 0;
+}
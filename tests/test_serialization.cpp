@@ -0,0 +1,180 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../lib/bloom_filter"
+
+/**
+ * Check that a loaded filter answers exactly like the original for members
+ * and non-members alike.
+ */
+template<typename original_t, typename loaded_t, typename value_t>
+bool same_answers(original_t const& original, loaded_t const& loaded,
+        std::vector<value_t> const& values)
+{
+    if (loaded.num_bits() != original.num_bits()
+            or loaded.num_hash_functions() != original.num_hash_functions())
+        return false;
+    for (auto const& v : values)
+    {
+        if (loaded.test(v) != original.test(v)) return false;
+    }
+    return true;
+}
+
+int main()
+{
+    constexpr size_t const num_hash_fns   = 7;
+    constexpr size_t const num_bits       = 958506;
+    constexpr size_t const num_test_items { 100000 };
+
+    std::default_random_engine generator;
+    std::uniform_int_distribution<int> dist;
+    std::vector<int> integers;
+    for (size_t i = 0; i < 2 * num_test_items; ++i) integers.push_back(dist(generator));
+
+    // round trip through a stream
+    dynamic_bloom_filter<int> filter (num_bits, num_hash_fns);
+    filter.add_batch(integers.data(), num_test_items);
+
+    std::stringstream stream;
+    filter.save(stream);
+    auto const loaded = dynamic_bloom_filter<int>::load(stream);
+    if (not same_answers(filter, loaded, integers))
+    {
+        std::cerr << "Filter loaded from a stream answers differently!\n";
+        return 1;
+    }
+
+    // the compile-time filter and double hashing round trip as well
+    bloom_filter<std::string, 6, 16, double_hashing> strings;
+    std::vector<std::string> words;
+    for (size_t i = 0; i < 2000; ++i) words.push_back("word " + std::to_string(i));
+    for (size_t i = 0; i < 1000; ++i) strings.add(words[i]);
+
+    std::stringstream string_stream;
+    strings.save(string_stream);
+    auto const loaded_strings = bloom_filter<std::string, 6, 16, double_hashing>::load(string_stream);
+    if (not same_answers(strings, loaded_strings, words))
+    {
+        std::cerr << "Double hashing filter loaded from a stream answers differently!\n";
+        return 1;
+    }
+
+    // loading with other parameters or another hasher must fail
+    string_stream.seekg(0);
+    try
+    {
+        bloom_filter<std::string, 7, 16, double_hashing>::load(string_stream);
+        std::cerr << "Loaded a filter with the wrong number of hash functions!\n";
+        return 1;
+    }
+    catch (std::runtime_error const&) {}
+
+    string_stream.seekg(0);
+    try
+    {
+        dynamic_bloom_filter<std::string, double_hashing, std_hasher>::load(string_stream);
+        std::cerr << "Loaded a filter with the wrong hasher!\n";
+        return 1;
+    }
+    catch (std::runtime_error const&) {}
+
+    // crafted headers must be rejected before anything is read, both the
+    // overflowing size of the bits and a salt count the scheme can not use
+    std::stringstream saved;
+    filter.save(saved);
+    std::string const bytes = saved.str();
+    auto const patch = [&bytes](std::uint64_t num_bits, std::uint64_t num_salts, std::uint64_t data_size)
+    {
+        detail::file_header header;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        header.num_bits = num_bits;
+        header.num_salts = num_salts;
+        header.data_offset = detail::data_offset(num_salts);
+        header.data_size = data_size;
+        std::string patched = bytes;
+        std::memcpy(&patched[0], &header, sizeof(header));
+        return patched;
+    };
+    std::string const crafted[] = {
+        patch(~0ull, num_hash_fns, 0),
+        patch(num_bits, num_hash_fns - 1, (num_bits + 63) / 64 * 8),
+        patch(num_bits, std::uint64_t{1} << 61, (num_bits + 63) / 64 * 8),
+    };
+    for (auto const& contents : crafted)
+    {
+        std::stringstream patched (contents);
+        try
+        {
+            dynamic_bloom_filter<int>::load(patched);
+            std::cerr << "Loaded a filter with a crafted header!\n";
+            return 1;
+        }
+        catch (std::runtime_error const&) {}
+    }
+
+    // query a file in place
+    std::string const path = "test_serialization.bloom";
+    {
+        std::ofstream file (path, std::ios::binary);
+        filter.save(file);
+    }
+    {
+        mapped_bloom_filter<int> const mapped (path);
+        if (not same_answers(filter, mapped, integers))
+        {
+            std::cerr << "Mapped filter answers differently!\n";
+            return 1;
+        }
+
+        std::vector<std::uint64_t> results ((integers.size() + 63) / 64);
+        mapped.test_batch(integers.data(), integers.size(), results.data());
+        for (size_t i = 0; i < integers.size(); ++i)
+        {
+            bool const batch_result = (results[i / 64] >> (i % 64)) & 1u;
+            if (batch_result != filter.test(integers[i]))
+            {
+                std::cerr << "Mapped filter batch interface answers differently!\n";
+                return 1;
+            }
+        }
+    }
+
+    // a truncated file must be rejected
+    {
+        std::ifstream in (path, std::ios::binary);
+        std::string const contents ((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::ofstream out (path, std::ios::binary | std::ios::trunc);
+        out.write(contents.data(), contents.size() / 2);
+    }
+    try
+    {
+        mapped_bloom_filter<int> const truncated (path);
+        std::cerr << "Mapped a truncated filter file!\n";
+        return 1;
+    }
+    catch (std::runtime_error const&) {}
+
+    // so must a mapped file with a crafted header
+    {
+        std::ofstream out (path, std::ios::binary | std::ios::trunc);
+        out.write(crafted[0].data(), crafted[0].size());
+    }
+    try
+    {
+        mapped_bloom_filter<int> const crafted_file (path);
+        std::cerr << "Mapped a filter with a crafted header!\n";
+        return 1;
+    }
+    catch (std::runtime_error const&) {}
+
+    std::remove(path.c_str());
+}
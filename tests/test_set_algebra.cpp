@@ -0,0 +1,154 @@
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../lib/bloom_filter"
+
+/**
+ * Check that the selected word kernels compute the same as the scalar ones,
+ * for lengths that leave a tail after the vector loop.
+ */
+bool check_kernels()
+{
+    std::default_random_engine generator;
+    std::uniform_int_distribution<std::uint64_t> dist;
+    auto const& kernels = detail::words::select();
+    for (size_t const count : { 0, 1, 7, 8, 9, 63, 64, 1000 })
+    {
+        std::vector<std::uint64_t> a (count);
+        std::vector<std::uint64_t> b (count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            a[i] = dist(generator);
+            b[i] = dist(generator);
+        }
+
+        auto expected = a;
+        auto actual = a;
+        detail::words::or_scalar(expected.data(), b.data(), count);
+        kernels.bitwise_or(actual.data(), b.data(), count);
+        if (actual != expected) return false;
+
+        expected = a;
+        actual = a;
+        detail::words::and_scalar(expected.data(), b.data(), count);
+        kernels.bitwise_and(actual.data(), b.data(), count);
+        if (actual != expected) return false;
+
+        if (not kernels.equal(a.data(), a.data(), count)) return false;
+        if (count > 0 and kernels.equal(a.data(), b.data(), count)) return false;
+        if (count > 0)
+        {
+            auto c = a;
+            c[count - 1] ^= 1;
+            if (kernels.equal(a.data(), c.data(), count)) return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    if (not check_kernels())
+    {
+        std::cerr << "Word kernels disagree with the scalar ones!\n";
+        return 1;
+    }
+
+    constexpr size_t const num_hash_fns = 7;
+    constexpr size_t const num_bits     = 958506;
+    constexpr size_t const num_values   = 100000;
+
+    // filters of partitions merge into the filter of all values
+    dynamic_bloom_filter<int> whole (num_bits, num_hash_fns);
+    std::vector<dynamic_bloom_filter<int>> parts (4, dynamic_bloom_filter<int>(num_bits, num_hash_fns));
+    for (int i = 0; i < static_cast<int>(num_values); ++i)
+    {
+        whole.add(i);
+        parts[i % parts.size()].add(i);
+    }
+    dynamic_bloom_filter<int> merged (num_bits, num_hash_fns);
+    merged.merge(parts[0]);
+    merged |= parts[1];
+    merged |= parts[2];
+    merged |= parts[3];
+    if (merged != whole or not (merged == whole))
+    {
+        std::cerr << "Merged filter differs from the filter of all values!\n";
+        return 1;
+    }
+    if (merged == parts[0])
+    {
+        std::cerr << "Filters with different bits compare equal!\n";
+        return 1;
+    }
+
+    // the intersection keeps the common values
+    dynamic_bloom_filter<int> evens (num_bits, num_hash_fns);
+    dynamic_bloom_filter<int> low (num_bits, num_hash_fns);
+    for (int i = 0; i < static_cast<int>(num_values); ++i)
+    {
+        if (i % 2 == 0) evens.add(i);
+        if (i < static_cast<int>(num_values / 2)) low.add(i);
+    }
+    evens &= low;
+    size_t others = 0;
+    for (int i = 0; i < static_cast<int>(num_values); ++i)
+    {
+        bool const common = i % 2 == 0 and i < static_cast<int>(num_values / 2);
+        if (common and not evens.test(i))
+        {
+            std::cerr << "Intersection lost a common value!\n";
+            return 1;
+        }
+        if (not common) others += evens.test(i);
+    }
+    if (others > num_values / 10)
+    {
+        std::cerr << "Intersection keeps " << others << " values of only one filter!\n";
+        return 1;
+    }
+
+    // compile-time filters combine the same way
+    bloom_filter<std::string, 1000, 1, double_hashing> a;
+    bloom_filter<std::string, 1000, 1, double_hashing> b;
+    a.add("alpha");
+    b.add("beta");
+    a |= b;
+    if (not a.test("alpha") or not a.test("beta"))
+    {
+        std::cerr << "Union of compile-time filters lost a value!\n";
+        return 1;
+    }
+
+    // incompatible filters are rejected
+    size_t rejected = 0;
+    dynamic_bloom_filter<int> smaller (num_bits - 1, num_hash_fns);
+    dynamic_bloom_filter<int> fewer (num_bits, num_hash_fns - 1);
+    try { merged.merge(smaller); }
+    catch (std::invalid_argument const&) { ++rejected; }
+    try { merged &= fewer; }
+    catch (std::invalid_argument const&) { ++rejected; }
+
+    // a filter with other salts, as if built by another program
+    std::stringstream stream;
+    whole.save(stream);
+    auto bytes = stream.str();
+    bytes[sizeof(detail::file_header)] ^= 1;
+    std::stringstream patched (bytes);
+    auto const salted = dynamic_bloom_filter<int>::load(patched);
+    try { merged |= salted; }
+    catch (std::invalid_argument const&) { ++rejected; }
+
+    if (rejected != 3 or merged.compatible(salted) or merged == salted)
+    {
+        std::cerr << "Combined incompatible filters!\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../lib/bloom_filter"
+
+/**
+ * Probe a shared filter from several threads. Each thread only gets a const
+ * reference. Returns false if any thread saw a false negative.
+ */
+template<typename filter_t>
+bool probe_from_threads(filter_t const& filter, std::vector<std::uint64_t> const& keys,
+        size_t const num_threads, double& seconds)
+{
+    std::vector<size_t> hits (num_threads);
+    auto const start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> readers;
+    for (size_t t = 0; t < num_threads; ++t)
+    {
+        readers.emplace_back([&filter, &keys, &hits, t]
+            {
+                size_t h = 0;
+                for (auto const& k : keys) h += filter.test(k);
+                hits[t] = h;
+            });
+    }
+    for (auto& r : readers) r.join();
+
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return std::all_of(hits.begin(), hits.end(), [&](size_t h) { return h == keys.size(); });
+}
+
+int main()
+{
+    constexpr size_t const num_hash_fns   = 7;
+    constexpr size_t const num_test_items { 1000000 };
+
+    std::vector<std::uint64_t> keys;
+    for (size_t i = 0; i < num_test_items; ++i) keys.push_back(i * 0x9e3779b97f4a7c15ull);
+
+    // build once, then only share read-only
+    dynamic_bloom_filter<std::uint64_t> filter (10 * num_test_items, num_hash_fns);
+    filter.add_batch(keys.data(), keys.size());
+    dynamic_bloom_filter<std::uint64_t> const& shared = filter;
+
+    size_t const max_threads = std::max(4u, std::thread::hardware_concurrency());
+    double single_thread_seconds = 0;
+    std::cout << "threads  probes/s      speedup\n";
+    for (size_t num_threads = 1; num_threads <= max_threads; num_threads *= 2)
+    {
+        double seconds = 0;
+        if (not probe_from_threads(shared, keys, num_threads, seconds))
+        {
+            std::cerr << "Concurrent reader got false negative!\n";
+            return 1;
+        }
+        if (num_threads == 1) single_thread_seconds = seconds;
+
+        // every thread does the same amount of work, so with linear scaling
+        // the time stays constant
+        double const probes_per_second = num_threads * keys.size() / seconds;
+        std::cout << num_threads << "\t " << probes_per_second
+            << "\t" << num_threads * single_thread_seconds / seconds << "\n";
+    }
+}
@@ -0,0 +1,84 @@
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../lib/bloom_filter"
+
+/**
+ * Check a batch test kernel against the scalar single key test.
+ */
+bool check_kernel(char const* name, detail::probe::test_batch_fn kernel,
+        std::vector<std::uint32_t> const& words, std::uint64_t const seed,
+        std::vector<std::uint64_t> const& keys)
+{
+    std::uint64_t const num_blocks = words.size() / detail::probe::block_words;
+    // odd count, to exercise the scalar tail of the vector kernels
+    size_t const count = keys.size() - 3;
+    std::vector<std::uint64_t> results ((count + 63) / 64);
+    kernel(words.data(), num_blocks, seed, keys.data(), count, results.data());
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        bool const expected = detail::probe::test(words.data(), num_blocks, seed, keys[i]);
+        if (((results[i / 64] >> (i % 64)) & 1u) != expected)
+        {
+            std::cerr << "Kernel " << name << " disagrees with scalar test!\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    constexpr size_t const num_test_items { 100000 };
+    std::default_random_engine generator;
+    std::uniform_int_distribution<int> dist (
+            std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+
+    // filter interface, with a key type that needs widening
+    std::vector<int> integers;
+    simd_blocked_bloom_filter<int> filter (16 * num_test_items);
+    for (size_t i = 0; i < num_test_items; ++i)
+    {
+        integers.push_back(dist(generator));
+    }
+    filter.add_batch(integers.data(), integers.size());
+
+    std::vector<std::uint64_t> results ((integers.size() + 63) / 64);
+    filter.test_batch(integers.data(), integers.size(), results.data());
+    for (size_t i = 0; i < integers.size(); ++i)
+    {
+        if (not filter.test(integers[i]) or not ((results[i / 64] >> (i % 64)) & 1u))
+        {
+            std::cerr << "Tested for membership of value and got false negative!\n";
+            return 1;
+        }
+    }
+
+    // every kernel the CPU supports gives the same results, on a filter that
+    // is about half full so both outcomes occur
+    constexpr std::uint64_t const seed = 0x5eed;
+    constexpr size_t const num_blocks = 1024;
+    std::vector<std::uint32_t> words (num_blocks * detail::probe::block_words);
+    std::vector<std::uint64_t> keys (4 * num_blocks);
+    std::mt19937_64 key_generator;
+    for (auto& k : keys) k = key_generator();
+    for (size_t i = 0; i < keys.size() / 2; ++i)
+    {
+        detail::probe::add(words.data(), num_blocks, seed, keys[i]);
+    }
+
+    if (not check_kernel("scalar", detail::probe::test_batch_scalar, words, seed, keys))
+        return 1;
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2")
+            and not check_kernel("avx2", detail::probe::test_batch_avx2, words, seed, keys))
+        return 1;
+    if (__builtin_cpu_supports("avx512f") and __builtin_cpu_supports("avx512dq")
+            and __builtin_cpu_supports("avx512vl")
+            and not check_kernel("avx512", detail::probe::test_batch_avx512, words, seed, keys))
+        return 1;
+#endif
+}
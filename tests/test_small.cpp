@@ -0,0 +1,126 @@
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../lib/bloom_filter"
+
+// the bits are all there is to a small filter
+static_assert(sizeof(small_bloom_filter<char, 16, 8>) == sizeof(std::uint64_t),
+        "16-bit filter takes more than a word");
+static_assert(sizeof(small_bloom_filter<int, 512, 7>) == 64 and alignof(small_bloom_filter<int, 512, 7>) == 64,
+        "512-bit filter is not one cache line");
+static_assert(small_bloom_filter<int, 100, 3>::num_words == 2, "100 bits take two words");
+
+/**
+ * Fill many filters with disjoint values each, and compare the false
+ * positive rate with the one expected for the parameters.
+ */
+template<size_t num_bits, size_t num_hash_fns>
+bool check_fpr(size_t const values_per_filter)
+{
+    constexpr size_t const num_filters = 2000;
+    constexpr size_t const probes_per_filter = 500;
+    std::vector<small_bloom_filter<std::uint64_t, num_bits, num_hash_fns>> filters (num_filters);
+
+    std::uint64_t next = 0;
+    for (auto& filter : filters)
+    {
+        for (size_t i = 0; i < values_per_filter; ++i)
+        {
+            filter.add(next);
+            if (not filter.test(next))
+            {
+                std::cerr << "Tested for membership of value and got false negative!\n";
+                return false;
+            }
+            ++next;
+        }
+    }
+
+    size_t false_positives = 0;
+    for (auto const& filter : filters)
+    {
+        for (size_t i = 0; i < probes_per_filter; ++i) false_positives += filter.test(next++);
+    }
+    double const fpr = static_cast<double>(false_positives) / (num_filters * probes_per_filter);
+    double const k = num_hash_fns;
+    double const expected = std::pow(1 - std::exp(-k * values_per_filter / num_bits), k);
+    if (fpr > 1.5 * expected)
+    {
+        std::cerr << num_bits << " bit filters have a false positive rate of " << fpr
+                  << " instead of " << expected << "!\n";
+        return false;
+    }
+    return true;
+}
+
+int main()
+{
+    std::array<char, 20> const chars =
+    { -75, 112, 95, -24, 77, -43, 126, 114, -66, 117, -18, -110, -68, -51, -36, 35, -116, -56, 51, 114 };
+    small_bloom_filter<char, 16, 8> tiny;
+    for (auto const c : chars) tiny.add(c);
+    for (auto const c : chars)
+    {
+        if (not tiny.test(c))
+        {
+            std::cerr << "Tested for membership of char and got false negative!\n";
+            return 1;
+        }
+    }
+
+    if (not check_fpr<64, 3>(8)) return 1;
+    if (not check_fpr<100, 4>(10)) return 1;
+    if (not check_fpr<512, 7>(50)) return 1;
+
+    // strings with either hasher
+    small_bloom_filter<std::string, 256, 5> words;
+    small_bloom_filter<std::string, 256, 5, std_hasher> std_words;
+    for (auto const* w : { "alpha", "beta", "gamma" })
+    {
+        words.add(w);
+        std_words.add(w);
+    }
+    if (not words.test("beta") or not std_words.test("gamma"))
+    {
+        std::cerr << "Tested for membership of string and got false negative!\n";
+        return 1;
+    }
+
+    // set algebra, and seeds change the bits
+    small_bloom_filter<int, 512, 7> a;
+    small_bloom_filter<int, 512, 7> b;
+    small_bloom_filter<int, 512, 7, wyhash_hasher, 42> seeded;
+    a.add(1);
+    b.add(2);
+    seeded.add(1);
+    if (seeded.words() == a.words())
+    {
+        std::cerr << "Seed does not change the bits!\n";
+        return 1;
+    }
+    auto both = a;
+    both |= b;
+    if (not both.test(1) or not both.test(2) or both == a or both.num_set_bits() > 14)
+    {
+        std::cerr << "Union lost a value!\n";
+        return 1;
+    }
+    both &= a;
+    if (both != a)
+    {
+        std::cerr << "Intersection with a subset is not the subset!\n";
+        return 1;
+    }
+    both.clear();
+    if (both.num_set_bits() != 0)
+    {
+        std::cerr << "Cleared filter has bits set!\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -1016,9 +1016,11 @@ int main()
     // }}}
 
     bloom_filter<std::string, num_hash_fns, precision> filter;
+    bloom_filter<std::string, num_hash_fns, precision, double_hashing> double_hashed;
     for (auto& str : strings)
     {
         filter.add(str);
+        double_hashed.add(str);
     }
 
     // check true positives
@@ -1029,6 +1031,11 @@ int main()
             std::cerr << "Tested for membership of value \"" << str << "\" and got false negative!\n";
             return 1;
         }
+        if (not double_hashed.test(str))
+        {
+            std::cerr << "Tested for membership of value \"" << str << "\" with double hashing and got false negative!\n";
+            return 1;
+        }
     }
 }
 